@@ -0,0 +1,418 @@
+#include "cache.h"
+#include "files.h"
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <utime.h>
+
+// Content addressed compile cache
+// Entries are files in the cache directory named by a 64 bit FNV-1a hash of
+// everything that went into them (input contents, options) plus a suffix for
+// which output they are. An entry is written to a temp file of its own (unique
+// per writer, so concurrent compiles storing the same entry don't mix their
+// writes) and renamed into place, so a half written entry is never found.
+// Entries are always real files; the compiler's files they're copied from and
+// to go through calc_fopen (they may be in memory in server mode).
+// Fetching an entry marks it used (its modification time). Once the directory
+// is bigger than CACHE_MAX_BYTES, the least recently used keys are evicted with
+// all of their entries, the marker of a whole program's set first, so a set
+// is never found without one of its entries.
+
+typedef struct cache_entry
+{
+	char * name;
+	unsigned long long key;
+	off_t size;
+	struct timespec used;
+} Cache_Entry;
+
+typedef struct cache_key
+{
+	int first;					// Entries of the key (consecutive once sorted by key)
+	int num_entries;
+	off_t size;
+	struct timespec used;		// When the key's most recently used entry was used
+} Cache_Key;
+
+char cache_dir[CACHE_PATH_LEN];		// Directory holding the entries
+int stored_entries = 0;				// Entries stored by this compile (the directory only needs trimming if it grew)
+
+// Use dir as the cache directory, creating it if it doesn't exist yet
+void cache_open(char * dir)
+{
+	if(strlen(dir) > CACHE_PATH_LEN - 32)
+	{
+		printf("Cache directory name too long\n");
+		exit(1);
+	}
+
+	if(mkdir(dir, 0755) != 0 && errno != EEXIST)
+	{
+		printf("Unable to create cache directory %s\n", dir);
+		exit(1);
+	}
+
+	strcpy(cache_dir, dir);
+
+	return;
+}
+
+// Mix bytes into a hash (FNV-1a)
+unsigned long long hash_bytes(const unsigned char * data, size_t len, unsigned long long hash)
+{
+	size_t i;
+	for(i = 0; i < len; i++)
+	{
+		hash ^= data[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+// Mix an option's value into a hash
+unsigned long long cache_hash_int(int value, unsigned long long hash)
+{
+	return hash_bytes((unsigned char *) &value, sizeof(value), hash);
+}
+
+// Mix a string into a hash
+unsigned long long cache_hash_string(char * str, unsigned long long hash)
+{
+	return hash_bytes((unsigned char *) str, strlen(str), hash);
+}
+
+// Mix a whole file's contents into a hash
+unsigned long long cache_hash_file(char * file_name, unsigned long long hash)
+{
+	FILE * file = calc_fopen(file_name, "rb");
+	if(file == NULL)
+	{
+		printf("Unable to open %s for hashing\n", file_name);
+		exit(1);
+	}
+
+	unsigned char buf[4096];
+	size_t len;
+	while((len = fread(buf, 1, sizeof(buf), file)) > 0)
+	{
+		hash = hash_bytes(buf, len, hash);
+	}
+
+	fclose(file);
+
+	return hash;
+}
+
+// Path of the entry for key and suffix
+void entry_path(char * path, unsigned long long key, char * suffix)
+{
+	sprintf(path, "%s/%016llx%s", cache_dir, key, suffix);
+
+	return;
+}
+
+// Copy an open file to the end of another
+void copy_stream(FILE * input_file, FILE * output_file)
+{
+	char buf[4096];
+	size_t len;
+	while((len = fread(buf, 1, sizeof(buf), input_file)) > 0)
+	{
+		fwrite(buf, 1, len, output_file);
+	}
+
+	return;
+}
+
+// Is there an entry for key and suffix
+int cache_has(unsigned long long key, char * suffix)
+{
+	char path[CACHE_PATH_LEN];
+	entry_path(path, key, suffix);
+
+	struct stat entry_stat;
+	return stat(path, &entry_stat) == 0;
+}
+
+// Copy the entry for key and suffix to a file
+// Returns 0 if there's no such entry
+int cache_fetch(unsigned long long key, char * suffix, char * output_file_name)
+{
+	char path[CACHE_PATH_LEN];
+	entry_path(path, key, suffix);
+
+	FILE * entry_file = fopen(path, "rb");
+	if(entry_file == NULL)
+	{
+		return 0;
+	}
+	utime(path, NULL);
+
+	FILE * output_file = calc_fopen(output_file_name, "wb");
+	if(output_file == NULL)
+	{
+		printf("Unable to create %s from compile cache\n", output_file_name);
+		exit(1);
+	}
+
+	copy_stream(entry_file, output_file);
+
+	fclose(entry_file);
+	fclose(output_file);
+
+	return 1;
+}
+
+// Copy the entry for key and suffix to the end of an open file
+// Returns 0 if there's no such entry
+int cache_fetch_append(unsigned long long key, char * suffix, FILE * output_file)
+{
+	char path[CACHE_PATH_LEN];
+	entry_path(path, key, suffix);
+
+	FILE * entry_file = fopen(path, "rb");
+	if(entry_file == NULL)
+	{
+		return 0;
+	}
+	utime(path, NULL);
+
+	copy_stream(entry_file, output_file);
+
+	fclose(entry_file);
+
+	return 1;
+}
+
+// Save a file as the entry for key and suffix
+void cache_store(unsigned long long key, char * suffix, char * input_file_name)
+{
+	char path[CACHE_PATH_LEN];
+	char temp_path[CACHE_PATH_LEN + 8];
+	entry_path(path, key, suffix);
+	sprintf(temp_path, "%s.XXXXXX", path);
+
+	FILE * input_file = calc_fopen(input_file_name, "rb");
+	if(input_file == NULL)
+	{
+		printf("Unable to open %s for compile cache\n", input_file_name);
+		exit(1);
+	}
+
+	int entry_fd = mkstemp(temp_path);
+	FILE * entry_file = entry_fd == -1 ? NULL : fdopen(entry_fd, "wb");
+	if(entry_file == NULL)
+	{
+		printf("Unable to create compile cache entry for %s\n", path);
+		exit(1);
+	}
+	fchmod(entry_fd, 0644);		// mkstemp makes it private; entries are read like any other file
+
+	copy_stream(input_file, entry_file);
+
+	int failed = ferror(input_file) || ferror(entry_file);
+	fclose(input_file);
+	failed = fclose(entry_file) != 0 || failed;
+
+	if(failed || rename(temp_path, path) != 0)
+	{
+		unlink(temp_path);
+		printf("Unable to write compile cache entry %s\n", path);
+		exit(1);
+	}
+	stored_entries++;
+
+	return;
+}
+
+// Parse the key of a file in the cache directory
+// Returns 0 if it isn't an entry; temp is set for an entry still being written
+int parse_entry_name(char * name, unsigned long long * key, int * temp)
+{
+	int i;
+	for(i = 0; i < 16; i++)
+	{
+		if(!((name[i] >= '0' && name[i] <= '9') || (name[i] >= 'a' && name[i] <= 'f')))
+		{
+			return 0;
+		}
+	}
+	if(name[16] != '-')
+	{
+		return 0;
+	}
+
+	*key = strtoull(name, NULL, 16);
+
+	char * ext = strrchr(name, '.');
+	*temp = ext == NULL || (strcmp(ext, ".txt") != 0 && strcmp(ext, ".c") != 0);
+
+	return 1;
+}
+
+// Order timestamps, oldest first
+int compare_times(struct timespec * a, struct timespec * b)
+{
+	if(a->tv_sec != b->tv_sec)
+	{
+		return a->tv_sec < b->tv_sec ? -1 : 1;
+	}
+	if(a->tv_nsec != b->tv_nsec)
+	{
+		return a->tv_nsec < b->tv_nsec ? -1 : 1;
+	}
+
+	return 0;
+}
+
+// Sort entries by key
+int compare_entry_keys(const void * a, const void * b)
+{
+	unsigned long long key_a = ((Cache_Entry *) a)->key;
+	unsigned long long key_b = ((Cache_Entry *) b)->key;
+
+	return key_a < key_b ? -1 : key_a > key_b;
+}
+
+// Sort keys by when they were last used, least recently used first
+int compare_key_used(const void * a, const void * b)
+{
+	return compare_times(&((Cache_Key *) a)->used, &((Cache_Key *) b)->used);
+}
+
+// Evict the least recently used keys once the cache directory is bigger than
+// CACHE_MAX_BYTES, down to CACHE_TRIM_BYTES
+// Only files named like entries are touched; temp files are only removed once
+// they're too old to still be written
+void cache_trim()
+{
+	if(stored_entries == 0)
+	{
+		return;
+	}
+
+	DIR * dir = opendir(cache_dir);
+	if(dir == NULL)
+	{
+		return;
+	}
+
+	Cache_Entry * entries = NULL;
+	int num_entries = 0;
+	int cap = 0;
+	long long total_size = 0;
+	time_t now = time(NULL);
+	char path[CACHE_PATH_LEN + NAME_MAX + 2];
+
+	struct dirent * dir_entry;
+	while((dir_entry = readdir(dir)) != NULL)
+	{
+		unsigned long long key;
+		int temp;
+		struct stat entry_stat;
+		if(strlen(dir_entry->d_name) > 63 || !parse_entry_name(dir_entry->d_name, &key, &temp))
+		{
+			continue;
+		}
+
+		snprintf(path, sizeof(path), "%s/%s", cache_dir, dir_entry->d_name);
+		if(lstat(path, &entry_stat) != 0 || !S_ISREG(entry_stat.st_mode))
+		{
+			continue;
+		}
+
+		if(temp)
+		{
+			if(now - entry_stat.st_mtime > CACHE_TEMP_MAX_AGE_SEC)
+			{
+				unlink(path);
+			}
+			continue;
+		}
+
+		if(num_entries >= cap)
+		{
+			cap = cap == 0 ? 256 : cap * 2;
+			entries = realloc(entries, sizeof(Cache_Entry) * cap);
+			if(entries == NULL)
+			{
+				printf("Couldn't allocate compile cache entries\n");
+				exit(1);
+			}
+		}
+
+		entries[num_entries].name = strdup(dir_entry->d_name);
+		entries[num_entries].key = key;
+		entries[num_entries].size = entry_stat.st_size;
+		entries[num_entries].used = entry_stat.st_mtim;
+		total_size += entry_stat.st_size;
+		num_entries++;
+	}
+	closedir(dir);
+
+	int i, j;
+	if(total_size > CACHE_MAX_BYTES)
+	{
+		// Group the entries by key
+		qsort(entries, num_entries, sizeof(Cache_Entry), compare_entry_keys);
+
+		Cache_Key * keys = malloc(sizeof(Cache_Key) * num_entries);
+		if(keys == NULL)
+		{
+			printf("Couldn't allocate compile cache keys\n");
+			exit(1);
+		}
+
+		int num_keys = 0;
+		for(i = 0; i < num_entries; i++)
+		{
+			if(num_keys == 0 || entries[keys[num_keys - 1].first].key != entries[i].key)
+			{
+				keys[num_keys].first = i;
+				keys[num_keys].num_entries = 0;
+				keys[num_keys].size = 0;
+				keys[num_keys].used = entries[i].used;
+				num_keys++;
+			}
+
+			Cache_Key * entry_key = &keys[num_keys - 1];
+			entry_key->num_entries++;
+			entry_key->size += entries[i].size;
+			if(compare_times(&entries[i].used, &entry_key->used) > 0)
+			{
+				entry_key->used = entries[i].used;
+			}
+		}
+
+		qsort(keys, num_keys, sizeof(Cache_Key), compare_key_used);
+
+		for(i = 0; i < num_keys && total_size > CACHE_TRIM_BYTES; i++)
+		{
+			entry_path(path, entries[keys[i].first].key, CACHE_MARKER_SUFFIX);
+			unlink(path);
+
+			for(j = keys[i].first; j < keys[i].first + keys[i].num_entries; j++)
+			{
+				snprintf(path, sizeof(path), "%s/%s", cache_dir, entries[j].name);
+				unlink(path);
+			}
+			total_size -= keys[i].size;
+		}
+
+		free(keys);
+	}
+
+	for(i = 0; i < num_entries; i++)
+	{
+		free(entries[i].name);
+	}
+	free(entries);
+
+	return;
+}
@@ -0,0 +1,19 @@
+#include <stdio.h>
+
+#define CACHE_VERSION			2		// Change when the compiler's output changes so old entries stop matching
+#define CACHE_PATH_LEN			256		// Max length of a cache entry's path
+#define CACHE_HASH_START		14695981039346656037ull		// FNV-1a 64 bit offset basis
+#define CACHE_MARKER_SUFFIX		"-tac.txt"	// Entry stored last for a whole program (marks a complete set)
+#define CACHE_MAX_BYTES			(256ll * 1024 * 1024)	// Least recently used keys are evicted once the directory is bigger
+#define CACHE_TRIM_BYTES		(CACHE_MAX_BYTES / 4 * 3)	// Eviction goes down to this, so not every compile has to evict
+#define CACHE_TEMP_MAX_AGE_SEC	3600	// Temp files left this long (by a writer that died) are removed
+
+void cache_open(char * dir);
+unsigned long long cache_hash_int(int value, unsigned long long hash);
+unsigned long long cache_hash_string(char * str, unsigned long long hash);
+unsigned long long cache_hash_file(char * file_name, unsigned long long hash);
+int cache_has(unsigned long long key, char * suffix);
+int cache_fetch(unsigned long long key, char * suffix, char * output_file_name);
+int cache_fetch_append(unsigned long long key, char * suffix, FILE * output_file);
+void cache_store(unsigned long long key, char * suffix, char * input_file_name);
+void cache_trim();
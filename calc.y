@@ -2,38 +2,129 @@
 // Benjamin Steenkamer
 // CPEG 621 Lab 2 - Calculator Compiler Back End
 
-#include <ctype.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "cache.h"
+#include "files.h"
+#include "intern.h"
+#include "peephole.h"
 #include "reg_alloc.h"
+#include "schedule.h"
+#include "server.h"
+
+#define EXPR_BLOCK_SIZE		256		// Expression nodes allocated at once when none can be recycled
+#define MAX_IF_DEPTH		64		// Max nesting of if/elses (? expressions)
+#define DRIVER_CHUNK_ROWS	4096	// Rows per unit of work in the generated batch driver
+#define DRIVER_MAX_THREADS	256		// Max threads the generated batch driver can run
 
 int yylex(void);					// Will be generated in lex.yy.c by flex
 
+// Expression tree node
+// Pure expressions (only operators, variables, and constants) are kept as trees
+// until they have to be written out, so they can be evaluated in Sethi-Ullman order
+typedef struct expr_node
+{
+	char * name;					// Leaf: variable, constant or temp var name (NULL for operator nodes)
+	char * op;						// Operator of the node: +, -, *, /, !, **
+	int need;						// Sethi-Ullman number: max temps alive at once while evaluating node
+	int top_needs[2];				// Two largest needs of the operands (used for + and * chains)
+
+	struct expr_node * first;		// Operand list; binary ops have 2, ! has 1
+	struct expr_node * last;		// + and * chains can have more (reassociated)
+	struct expr_node * next;		// Next operand in parent's operand list
+
+	struct expr_node * pending_prev;	// Operator nodes not yet part of another tree
+	struct expr_node * pending_next;	// (in left to right order)
+} Expr;
+
+// Operand of a + or * chain, with its original left to right position
+typedef struct chain_operand
+{
+	Expr * expr;
+	int order;
+} Chain_Operand;
+
 // Following are defined below in sub-routines section
-void my_free(char * ptr);
-char* lc(char *str);
-void gen_tac_assign(char * var, char * expr);
+void release_name(char * name);
+Expr* new_leaf(char * name);
+Expr* new_op(Expr * one, char * op, Expr * three);
+char* materialize(Expr * expr);
+void flush_pending_exprs();
+void free_expr(Expr * expr);
+void write_tac(const char * format, ...);
+void gen_tac_assign(char * var, Expr * expr);
 char* gen_tac_expr(char * one, char * op, char * three);
-void gen_tac_if(char * cond_expr);
+void gen_tac_if(Expr * cond_expr);
+void gen_tac_end_arm();
 void gen_tac_assign_else(char * expr);
+void open_deferred_ifs();
+void gen_tac_select(char * var, char * value);
 void gen_tac_empty_else();
 void track_user_var(char * var, int assigned);
+void end_statement();
+int fetch_cached_outputs();
+void store_cached_outputs();
 void gen_c_code();
+void convert_tac_line(char * line_buf);
+void gen_c_ipow();
+void gen_c_batch_code(char * input, char * output);
+void gen_c_driver_code(char * input, char * output);
 void yyerror(const char *);
 
 int do_gen_else = 0;				// When set do the else part of the if/else statement
-int num_temp_vars = 0;				// Number of temp vars in use
+
+// A ?'s if line is held back until it's known whether its arm has a side effect
+// If it doesn't, the if/else is lowered to a select (x = c ? v; means x = c ? v : 0)
+char * deferred_conds[MAX_IF_DEPTH];	// Conditions of the ?s whose if line hasn't been written (outermost first)
+int deferred_arms[MAX_IF_DEPTH];		// Arm of the deferred ? that's still being parsed, -1 when it's done
+int num_deferred = 0;
+int arm_deferred[MAX_IF_DEPTH];			// Set while an arm being parsed still has its if line held back
+int arm_depth = 0;						// Number of ? arms being parsed
+int num_temp_vars = 0;				// Number of distinct temp var names created (_t0 ... _tN)
+int temp_in_use[MAX_TOTAL_VARS];	// Set when the temp var's current value hasn't been consumed yet
+char * temp_names[MAX_TOTAL_VARS];	// Interned name of each temp var (created on first use)
 int num_user_vars = 0;				// Number of user variables in use
 int num_user_vars_wo_def = 0;		// Number of user variables that didn't have declarations
 char user_vars[MAX_USR_NUM_VARS][MAX_USR_VAR_NAME_LEN + 1];			// List of all unique user vars in proper
 char user_vars_wo_def[MAX_USR_NUM_VARS][MAX_USR_VAR_NAME_LEN + 1];	// List of user vars used w/o definition
 
+Expr * pending_head = NULL;			// Operator nodes that haven't been written out yet
+Expr * pending_tail = NULL;
+Expr * free_exprs = NULL;			// Recycled expression nodes (linked through next)
+
+Chain_Operand * chain_stack = NULL;	// Operands of the + and * chains being written out
+int chain_stack_size = 0;
+int chain_stack_top = 0;
+
+int alloc_mode = ALLOC_HEURISTIC;	// Register allocation algorithm (see reg_alloc.h)
+int stream_window = 0;				// Max statements per register allocation region (0 = whole program at once)
+int window_statements = 0;			// Statements in current region so far
+unsigned long long statement_hash = CACHE_HASH_START;	// Hash of the current statement's TAC (picks region boundaries)
+int gen_batch = 0;					// Also generate the batch evaluation (SIMD) C backend
+int gen_driver = 0;					// Also generate the multi-threaded batch driver
+int do_schedule = 0;				// List schedule the TAC before register allocation (see schedule.c)
+char * cache_dir_name = NULL;		// Compile cache directory (NULL = no caching)
+unsigned long long region_key_start;	// Hash of the options that affect register allocation
+unsigned long long program_key;			// Hash of the input program and all options
+
 int flex_line_num = 1;		// Used for debugging
 FILE * yyin;				// Input calc program file pointer
-FILE * tac_file;			// Three address code file pointer
+FILE * tac_file;			// Three address code file pointer (current region's TAC when streaming)
+FILE * frontend_tac_file;	// Whole program's three address code file pointer when streaming
+FILE * reg_tac_file;		// Register allocated TAC file pointer when streaming
+FILE * sched_tac_file;		// Whole program's scheduled TAC file pointer when streaming
 FILE * c_code_file;			// C code produced by backend file pointer
+
+char * frontend_tac_name = "Output/tac-frontend.txt";
+char * window_tac_name = "Output/tac-window.txt";
+char * window_reg_tac_name = "Output/tac-window-reg.txt";
+char * window_sched_tac_name = "Output/tac-window-sched.txt";
+char * sched_tac_file_name = "Output/tac-sched.txt";
+char * reg_tac_file_name = "Output/tac-reg-alloc.txt";
+char * opt_reg_tac_file_name = "Output/opt-tac-reg-alloc.txt";
 %}
 
 %define parse.error verbose		// Enable verbose errors
@@ -46,15 +137,16 @@ FILE * c_code_file;			// C code produced by backend file pointer
 {
 	int dval;
 	char * str;
+	struct expr_node * expr;
 }
 
 // When %union is used to specify multiple value types, must declare the
 // value type of each token for which values are used
-// In this case, all values associated with tokens are to be strings
+// Variable names and constants are interned strings (see intern.c)
 %type <str> INTEGER POWER VARIABLE
 
-// Conditional expressions and expressions values are also string type
-%type <str> expr
+// Conditional expressions and expressions values are expression trees
+%type <expr> expr
 
 // Make grammar unambiguous
 // Low to high precedence and associativity within a precedent rank
@@ -71,358 +163,1692 @@ FILE * c_code_file;			// C code produced by backend file pointer
 %%
 
 calc :
-	calc expr '\n'		{ my_free($2); gen_tac_empty_else(); }
+	calc expr '\n'		{ flush_pending_exprs(); free_expr($2); gen_tac_empty_else(); end_statement(); }
 	|
 	;
 
 expr :
-	INTEGER				{ $$ = $1; }
-	| VARIABLE        	{ $$ = lc($1); track_user_var(lc($1), 0); }
-	| VARIABLE '=' expr	{ $$ = lc($1); gen_tac_assign(lc($1), $3); my_free($3); }
-	| expr '+' expr		{ $$ = gen_tac_expr($1, "+", $3); my_free($1); my_free($3); }
-	| expr '-' expr		{ $$ = gen_tac_expr($1, "-", $3); my_free($1); my_free($3); }
-	| expr '*' expr		{ $$ = gen_tac_expr($1, "*", $3); my_free($1); my_free($3); }
-	| expr '/' expr		{ $$ = gen_tac_expr($1, "/", $3); my_free($1); my_free($3); }
-	| '!' expr			{ $$ = gen_tac_expr(NULL, "!", $2); my_free($2); }		// Bitwise not in calc lang
-	| expr POWER expr	{ $$ = gen_tac_expr($1, "**", $3); my_free($1); my_free($3);}
+	INTEGER				{ $$ = new_leaf($1); }
+	| VARIABLE        	{ $$ = new_leaf($1); track_user_var($1, 0); }
+	| VARIABLE '=' expr	{ $$ = new_leaf($1); gen_tac_assign($1, $3); free_expr($3); }
+	| expr '+' expr		{ $$ = new_op($1, "+", $3); }
+	| expr '-' expr		{ $$ = new_op($1, "-", $3); }
+	| expr '*' expr		{ $$ = new_op($1, "*", $3); }
+	| expr '/' expr		{ $$ = new_op($1, "/", $3); }
+	| '!' expr			{ $$ = new_op(NULL, "!", $2); }		// Bitwise not in calc lang
+	| expr POWER expr	{ $$ = new_op($1, "**", $3); }
 	| '(' expr ')'		{ $$ = $2; }					// Will give syntax error for unmatched parens
 	| '(' expr ')' '?' { gen_tac_if($2); } '(' expr ')'
 						{
 							$$ = $7;
-							do_gen_else++;	// Keep track of how many closing elses are need for 
-							my_free($2);	// nested if/else cases
-						}
+							gen_tac_end_arm();	// Keep track of how many closing elses are need for
+						}						// nested if/else cases
 	;
 
 %%
 
-// Used for debugging
-// Print out token being freed
-void my_free(char * ptr)
+// Names are interned and never freed; this marks the end of a name's use
+// Temp vars are only used once, so releasing a temp var's name frees the temp for reuse
+void release_name(char * name)
 {
-	if(ptr == NULL)
-	{
-		yyerror("Tried to free null pointer!");
-	}
-	else
+	if(name[0] == '_' && name[1] == 't')
 	{
-		// printf("Freed token: %s\n", ptr);
-		free(ptr);
+		temp_in_use[atoi(name + 2)] = 0;
 	}
 
 	return;
 }
 
-// Convert a string to lower case
-// Use to this to help enforce variable names being case insensitive
-char* lc(char *str)
+////// START EXPRESSION TREE FUNCTIONS ///////
+
+// Add operator node to the end of the pending list
+void push_pending(Expr * expr)
 {
-	int i;
-	for (i = 0; i < strlen(str); i++)
+	expr->pending_prev = pending_tail;
+	expr->pending_next = NULL;
+
+	if(pending_tail != NULL)
 	{
-		str[i] = tolower(str[i]);
+		pending_tail->pending_next = expr;
 	}
+	else
+	{
+		pending_head = expr;
+	}
+	pending_tail = expr;
 
-	return str;
+	return;
 }
 
-// For case where variable is being assigned an expression
-void gen_tac_assign(char * var, char * expr)
+// Take operator node out of the pending list (it was written out or became an operand)
+void remove_pending(Expr * expr)
 {
-	track_user_var(var, 1);
+	if(expr->pending_prev != NULL)
+	{
+		expr->pending_prev->pending_next = expr->pending_next;
+	}
+	else
+	{
+		pending_head = expr->pending_next;
+	}
 
-	fprintf(tac_file, "%s = %s;\n", var, expr);
+	if(expr->pending_next != NULL)
+	{
+		expr->pending_next->pending_prev = expr->pending_prev;
+	}
+	else
+	{
+		pending_tail = expr->pending_prev;
+	}
 
-	gen_tac_assign_else(var);
+	expr->pending_prev = NULL;
+	expr->pending_next = NULL;
 
 	return;
 }
 
-// Generates and writes out string of three address code
-// Returns temporary variable's name (that must be freed later)
-char* gen_tac_expr(char * one, char * op, char * three)
+// Get an expression node from the recycled nodes
+// When there are none left, a whole block of new nodes is allocated at once
+Expr* alloc_expr()
 {
-	char tmp_var_name[13]; 	// temp var names: _t0123456789
-
-	// Create the temp variable name
-	sprintf(tmp_var_name, "_t%d", num_temp_vars);
-	num_temp_vars++;
-
-	if (one != NULL)
-	{
-		// Write out three address code
-		fprintf(tac_file, "%s = %s %s %s;\n", tmp_var_name, one, op, three);
-	}
-	else	// Unary operator case
+	if(free_exprs == NULL)
 	{
-		fprintf(tac_file, "%s = %s%s;\n", tmp_var_name, op, three);
+		Expr * block = malloc(sizeof(Expr) * EXPR_BLOCK_SIZE);
+		if(block == NULL)
+		{
+			yyerror("Couldn't allocate expression nodes");
+			exit(1);
+		}
+
+		int i;
+		for(i = 0; i < EXPR_BLOCK_SIZE; i++)
+		{
+			block[i].next = free_exprs;
+			free_exprs = &block[i];
+		}
 	}
 
-	return strdup(tmp_var_name);
+	Expr * expr = free_exprs;
+	free_exprs = expr->next;
+	memset(expr, 0, sizeof(Expr));
+
+	return expr;
 }
 
-// Print out the if part of the if/else statement
-void gen_tac_if(char * cond_expr)
+// Give an expression node back to be recycled
+void recycle_expr(Expr * expr)
 {
-	fprintf(tac_file, "if(%s) {\n", cond_expr);
+	expr->next = free_exprs;
+	free_exprs = expr;
 
 	return;
 }
 
-// Print out closing brace of if statement and the whole else statement
-// else will be a variable being assigned to a value of zero
-void gen_tac_assign_else(char * expr)
+// Create leaf node for a variable, constant or temp var name (interned)
+Expr* new_leaf(char * name)
 {
-	for (; do_gen_else > 0; do_gen_else--)
+	Expr * leaf = alloc_expr();
+	leaf->name = name;
+
+	return leaf;
+}
+
+// Add operand to the end of node's operand list
+// Keeps track of the two largest operand needs
+void add_operand(Expr * expr, Expr * operand)
+{
+	operand->next = NULL;
+
+	if(expr->last != NULL)
+	{
+		expr->last->next = operand;
+	}
+	else
+	{
+		expr->first = operand;
+	}
+	expr->last = operand;
+
+	if(operand->need > expr->top_needs[0])
 	{
-		fprintf(tac_file, "} else {\n%s = 0;\n}\n", expr);
+		expr->top_needs[1] = expr->top_needs[0];
+		expr->top_needs[0] = operand->need;
+	}
+	else if(operand->need > expr->top_needs[1])
+	{
+		expr->top_needs[1] = operand->need;
 	}
 
 	return;
 }
 
-// If the result of the conditional expression is not being written to a variable
-// the else part will be empty
-void gen_tac_empty_else()
+// Add an operand to a + or * node; an operand that is a chain of the same operator
+// is merged in (reassociated) so the whole chain can be evaluated in any order
+// + and * on ints are associative and commutative (wrap around), other ops are not
+void add_chain_operand(Expr * expr, Expr * operand)
 {
-	for (; do_gen_else > 0; do_gen_else--)
+	if(operand->name == NULL && strcmp(operand->op, expr->op) == 0)
+	{
+		Expr * child = operand->first;
+		while(child != NULL)
+		{
+			Expr * next = child->next;
+			add_operand(expr, child);
+			child = next;
+		}
+
+		remove_pending(operand);
+		recycle_expr(operand);
+	}
+	else
 	{
-		fprintf(tac_file, "} else {\n}\n");
+		if(operand->name == NULL)
+		{
+			remove_pending(operand);
+		}
+		add_operand(expr, operand);
 	}
 
 	return;
 }
 
-// Records all first appearances of user variables for use in C code generation
-// If variable is not being defined and hasn't been used before, add it to list of uninitialized variables
-void track_user_var(char *var, int assigned)
+// Create operator node; one is NULL for the unary ! operator
+// Computes the Sethi-Ullman number of the node: evaluating the operand with the
+// larger need first keeps the fewest temps alive at once
+Expr* new_op(Expr * one, char * op, Expr * three)
 {
-	// Check if variable has been recorded before
-	int i;
-	for(i = 0; i < num_user_vars; i++)
+	Expr * expr = new_leaf(NULL);
+	expr->op = op;
+
+	int is_chain = (strcmp(op, "+") == 0 || strcmp(op, "*") == 0);
+
+	if(one != NULL)
 	{
-		if(strcmp(user_vars[i], var) == 0)
+		if(is_chain)
 		{
-			return; // If the variable was already recorded, don't need to record it again
+			add_chain_operand(expr, one);
+		}
+		else
+		{
+			if(one->name == NULL)
+			{
+				remove_pending(one);
+			}
+			add_operand(expr, one);
 		}
 	}
 
-	// Check if variable is valid
-	if(num_user_vars >= MAX_USR_NUM_VARS)
+	if(is_chain)
 	{
-		yyerror("Max number of user variables reached");
-		exit(1);	// Exit since variable (and therefor the entire program) is not valid
+		add_chain_operand(expr, three);
 	}
-	else if (strlen(var) > MAX_USR_VAR_NAME_LEN)
+	else
 	{
-		yyerror("Variable name too long");
-		exit(1); 	// Exit since variable (and therefor the entire program) is not valid
+		if(three->name == NULL)
+		{
+			remove_pending(three);
+		}
+		add_operand(expr, three);
 	}
 
-	// If the variable hasn't been seen before, need to record its first appearance
-	if(!assigned)	// If variable is not being assigned a value, then it's first use is without a definition
+	// The first operand evaluated holds 1 temp (if it isn't a leaf) while the
+	// next largest one is evaluated; the node's own result always takes a temp
+	int first_evaluated_result = expr->top_needs[0] > 0 ? 1 : 0;
+	expr->need = expr->top_needs[0];
+	if(first_evaluated_result + expr->top_needs[1] > expr->need)
 	{
-		strcpy(user_vars_wo_def[num_user_vars_wo_def], var);
-		num_user_vars_wo_def++;
+		expr->need = first_evaluated_result + expr->top_needs[1];
+	}
+	if(expr->need < 1)
+	{
+		expr->need = 1;
 	}
 
-	strcpy(user_vars[num_user_vars], var);
-	num_user_vars++;
+	push_pending(expr);
 
-	return;
+	return expr;
 }
 
-// Take the TAC and generate a valid C program code
-void gen_c_code(char * input, char * output, int regs)
+// Helper function for emit_chain (used with qsort)
+// Sort operands by need, largest first; leaves go last
+// Ties keep their original left to right order
+int compare_chain_operands(const void * a, const void * b)
 {
-	// Open files for reading TAC and writing C code
-	tac_file = fopen(input, "r");
-	c_code_file = fopen(output, "w");
-	if (tac_file == NULL)
-	{
-		yyerror("Couldn't open TAC file in C code generation step");
-		exit(1);
-	}
-	if (c_code_file == NULL)
+	const Chain_Operand * op_a = (const Chain_Operand *) a;
+	const Chain_Operand * op_b = (const Chain_Operand *) b;
+
+	if(op_a->expr->need != op_b->expr->need)
 	{
-		yyerror("Couldn't create C code output file");
-		exit(1);
+		return op_b->expr->need - op_a->expr->need;
 	}
 
-	int i;
-	fprintf(c_code_file, "#include <stdio.h>\n#include <math.h>\n\nint main() {\n");
+	return op_a->order - op_b->order;
+}
 
-	// Declare all user variables and initialize them to 0
-	if (num_user_vars > 0)
+char* emit_expr(Expr * expr);
+
+// Write out a + or * chain: evaluate the operand with the largest need first,
+// then accumulate the rest into it in decreasing need order
+char* emit_chain(Expr * expr)
+{
+	int num_operands = 0;
+	Expr * child;
+	for(child = expr->first; child != NULL; child = child->next)
 	{
-		fprintf(c_code_file, "\tint ");
+		num_operands++;
 	}
-	for(i = 0; i < num_user_vars; i++)
+
+	// Operands are kept on chain_stack; nested chains push theirs above this one
+	// The stack can move when it grows, so it's only ever accessed by index
+	int base = chain_stack_top;
+	if(base + num_operands > chain_stack_size)
 	{
-		if (i != num_user_vars - 1)
-		{
-			fprintf(c_code_file, "%s = 0, ", user_vars[i]);
-		}
-		else
+		chain_stack_size = (base + num_operands) * 2;
+		chain_stack = realloc(chain_stack, sizeof(Chain_Operand) * chain_stack_size);
+		if(chain_stack == NULL)
 		{
-			fprintf(c_code_file, "%s = 0;\n", user_vars[i]);
+			yyerror("Couldn't allocate expression operands");
+			exit(1);
 		}
 	}
+	chain_stack_top += num_operands;
 
-	// Declare all temp variables and initialize them to 0
-	if (num_temp_vars > 0)
+	int i = 0;
+	for(child = expr->first; child != NULL; child = child->next)
 	{
-		fprintf(c_code_file, "\tint ");
+		chain_stack[base + i].expr = child;
+		chain_stack[base + i].order = i;
+		i++;
 	}
-	for(i = 0; i < num_temp_vars; i++)
+
+	qsort(&chain_stack[base], num_operands, sizeof(Chain_Operand), compare_chain_operands);
+
+	char * acc = emit_expr(chain_stack[base].expr);
+	for(i = 1; i < num_operands; i++)
 	{
-		if(i < num_temp_vars - 1)
+		char * value = emit_expr(chain_stack[base + i].expr);
+		char * result = gen_tac_expr(acc, expr->op, value);
+		release_name(acc);
+		release_name(value);
+		acc = result;
+	}
+
+	chain_stack_top = base;
+
+	return acc;
+}
+
+// Write out the TAC of an expression tree in Sethi-Ullman order
+// Returns name holding the result (must be released later); recycles the tree
+char* emit_expr(Expr * expr)
+{
+	char * result;
+
+	if(expr->name != NULL)			// Leaf, nothing to evaluate
+	{
+		result = expr->name;
+	}
+	else if(expr->first->next == NULL)	// Unary ! operator
+	{
+		char * value = emit_expr(expr->first);
+		result = gen_tac_expr(NULL, expr->op, value);
+		release_name(value);
+	}
+	else if(strcmp(expr->op, "+") == 0 || strcmp(expr->op, "*") == 0)
+	{
+		result = emit_chain(expr);
+	}
+	else	// Non commutative binary operator; operand order stays, evaluation order may swap
+	{
+		Expr * one = expr->first;
+		Expr * three = expr->first->next;
+		char * one_value;
+		char * three_value;
+
+		if(three->need > one->need)
 		{
-			fprintf(c_code_file, "_t%d = 0, ", i);
+			three_value = emit_expr(three);
+			one_value = emit_expr(one);
 		}
 		else
 		{
-			fprintf(c_code_file, "_t%d = 0;\n", i);
+			one_value = emit_expr(one);
+			three_value = emit_expr(three);
 		}
+
+		result = gen_tac_expr(one_value, expr->op, three_value);
+		release_name(one_value);
+		release_name(three_value);
 	}
 
-	// Create register variables
-	if(regs)
+	recycle_expr(expr);
+
+	return result;
+}
+
+// Write out the TAC for an expression (if it hasn't been already)
+// Node becomes a leaf holding the name of the result
+char* materialize(Expr * expr)
+{
+	if(expr->name == NULL)
 	{
-		fprintf(c_code_file, "\tint ");
-		for(i = 0; i < NUM_REG; i++)
-		{
-			if(i < NUM_REG - 1)
-			{
-				fprintf(c_code_file, "_r%d = 0, ", i + 1);
-			}
-			else
-			{
-				fprintf(c_code_file, "_r%d = 0;\n", i + 1);
-			}
-		}
+		remove_pending(expr);
+
+		Expr * tree = alloc_expr();
+		*tree = *expr;						// Move the operator node out so expr can become a leaf
+		expr->name = emit_expr(tree);
+		expr->op = NULL;
+		expr->need = 0;
+		expr->first = NULL;
+		expr->last = NULL;
 	}
 
-	fprintf(c_code_file, "\n");
+	return expr->name;
+}
 
-	// Initialize user variables not assigned (ask user input for variables)
-	for (i = 0; i < num_user_vars_wo_def; i++)
+// Does evaluating the expression divide (can trap, so it can't be moved out of an if)
+int has_division(Expr * expr)
+{
+	if(expr->name != NULL)
 	{
-		fprintf(c_code_file, "\tprintf(\"%s=\");\n", user_vars_wo_def[i]);
-		fprintf(c_code_file, "\tscanf(\"%%d\", &%s);\n\n", user_vars_wo_def[i]);
+		return 0;
 	}
 
-	// Read in TAC file, write to c file with line labels
-	// Convert lines with ** or ! and replace with pow or ~
-	char line_buf[MAX_USR_VAR_NAME_LEN * 4];
-	char *bitwise;
-	char *pow;
-	i = 0;
-	while(fgets(line_buf, MAX_USR_VAR_NAME_LEN * 4, tac_file) != NULL)
+	if(strcmp(expr->op, "/") == 0)
 	{
-		// Don't print label if line is a closing } or else statement
-		if(strcmp(line_buf, "}\n") == 0 || strcmp(line_buf, "} else {\n") == 0)
-		{
-			fprintf(c_code_file, "\t\t\t%s", line_buf);
-			continue;
-		}
-
-		bitwise = strstr(line_buf, "!");
-		pow = strstr(line_buf, "**");
+		return 1;
+	}
 
-		if(bitwise != NULL) 		// Replace ! with ~
+	Expr * operand;
+	for(operand = expr->first; operand != NULL; operand = operand->next)
+	{
+		if(has_division(operand))
 		{
-			*bitwise = '~';
+			return 1;
 		}
-		else if(pow != NULL)		// Split up the line with a ** and reformat it with a pow() func
-		{
-			char temp[MAX_USR_VAR_NAME_LEN * 4];
-			strcpy(temp, line_buf);
-
-			char *first = strtok(temp, " =*;");		// Lines with ** will always have 3 operands
-			char *second = strtok(NULL, " =*;");
-			char *third = strtok(NULL, " =*;");
+	}
 
-			sprintf(line_buf, "%s = (int)pow(%s, %s);\n", first, second, third);
-		}
+	return 0;
+}
 
-		// Print c code line with line # label
-		if(i < 10)
-		{
-			fprintf(c_code_file, "\tS%d:\t\t%s", i, line_buf);
-		}
-		else
+// Write out all pending expressions in left to right order
+// Must be called before any side effect (assignment or if) is written out
+// so pure expressions to the left of it read variables before the side effect
+// Divisions stay under the ifs of any held back ?s
+void flush_pending_exprs()
+{
+	Expr * expr;
+	for(expr = pending_head; expr != NULL && num_deferred > 0; expr = expr->pending_next)
+	{
+		if(has_division(expr))
 		{
-			fprintf(c_code_file, "\tS%d:\t%s", i, line_buf);
+			open_deferred_ifs();
 		}
+	}
 
-		i++;	// Increment line number
+	while(pending_head != NULL)
+	{
+		materialize(pending_head);
 	}
 
-	fprintf(c_code_file, "\n");
+	return;
+}
 
-	// Print out user variable final values
-	for(i = 0; i < num_user_vars; i++)
+// Free an expression that has already been written out
+void free_expr(Expr * expr)
+{
+	if(expr->name == NULL)
 	{
-		fprintf(c_code_file, "\tprintf(\"%s=%%d\\n\", %s);\n", user_vars[i], user_vars[i]);
+		yyerror("Tried to free expression that wasn't written out!");
+		return;
 	}
 
-	fprintf(c_code_file, "\n\treturn 0;\n}\n");
-
-	// Close files from C code generation
-	fclose(tac_file);
-	fclose(c_code_file);
+	release_name(expr->name);
+	recycle_expr(expr);
 
 	return;
 }
 
-void yyerror(const char *s)
-{
-	printf("%s\n", s);
-}
+////// END EXPRESSION TREE FUNCTIONS ///////
 
-int main(int argc, char *argv[])
+// Write out TAC lines of the current statement
+// When streaming, their text is also mixed into the statement's hash
+void write_tac(const char * format, ...)
 {
-	// Open the input program file
-	if (argc != 2)
+	char buf[MAX_USR_VAR_NAME_LEN * 8];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buf, sizeof(buf), format, args);
+	va_end(args);
+
+	fputs(buf, tac_file);
+	if (stream_window > 0)
 	{
-		yyerror("Need to provide input file");
-		exit(1);
+		statement_hash = cache_hash_string(buf, statement_hash);
 	}
-	else
+
+	return;
+}
+
+// For case where variable is being assigned an expression
+// Inside a ? arm the assignment is a side effect, so the arm needs a real if
+// Otherwise the held back ?s only decide between the value and 0
+void gen_tac_assign(char * var, Expr * expr)
+{
+	int i;
+	for(i = 0; i < num_deferred; i++)
 	{
-		yyin = fopen(argv[1], "r");
-		if(yyin == NULL)
+		if(deferred_arms[i] != -1)
 		{
-			yyerror("Couldn't open input file");
-			exit(1);
+			open_deferred_ifs();
 		}
 	}
 
-	// Open the output file where the three address codes will be written
-	char * frontend_tac_name = "Output/tac-frontend.txt";
-	tac_file = fopen(frontend_tac_name, "w");
-	
-	if (tac_file == NULL)
-	{
+	flush_pending_exprs();
+
+	track_user_var(var, 1);
+
+	if(num_deferred > 0)
+	{
+		gen_tac_select(var, expr->name);
+	}
+	else
+	{
+		write_tac("%s = %s;\n", var, expr->name);
+	}
+
+	gen_tac_assign_else(var);
+
+	return;
+}
+
+// Generates and writes out string of three address code
+// Returns temporary variable's name (that must be released later)
+char* gen_tac_expr(char * one, char * op, char * three)
+{
+	// Reuse the lowest numbered temp var that isn't holding a value
+	int temp_num = 0;
+	while(temp_num < MAX_TOTAL_VARS && temp_in_use[temp_num])
+	{
+		temp_num++;
+	}
+
+	if(temp_num >= MAX_TOTAL_VARS)
+	{
+		yyerror("Max number of temp variables in use reached");
+		exit(1);
+	}
+
+	temp_in_use[temp_num] = 1;
+	if(temp_num >= num_temp_vars)
+	{
+		num_temp_vars = temp_num + 1;
+	}
+
+	// Create the temp variable name the first time the temp is used
+	if(temp_names[temp_num] == NULL)
+	{
+		char tmp_var_name[13]; 	// temp var names: _t0123456789
+		int len = sprintf(tmp_var_name, "_t%d", temp_num);
+		temp_names[temp_num] = intern(tmp_var_name, len);
+	}
+	char * tmp_var_name = temp_names[temp_num];
+
+	if (one != NULL)
+	{
+		// Write out three address code
+		write_tac("%s = %s %s %s;\n", tmp_var_name, one, op, three);
+	}
+	else	// Unary operator case
+	{
+		write_tac("%s = %s%s;\n", tmp_var_name, op, three);
+	}
+
+	return tmp_var_name;
+}
+
+// Start the if part of the if/else statement
+// The if line is held back (see open_deferred_ifs and gen_tac_select)
+// The condition's name stays in use until it's written out
+void gen_tac_if(Expr * cond_expr)
+{
+	flush_pending_exprs();
+
+	if(num_deferred >= MAX_IF_DEPTH || arm_depth >= MAX_IF_DEPTH)
+	{
+		yyerror("Max nesting of ? expressions reached");
+		exit(1);
+	}
+
+	deferred_conds[num_deferred] = cond_expr->name;
+	deferred_arms[num_deferred] = arm_depth;
+	num_deferred++;
+
+	arm_deferred[arm_depth] = 1;
+	arm_depth++;
+
+	recycle_expr(cond_expr);
+
+	return;
+}
+
+// The arm of a ? has been parsed; its if/else ends at the next assignment
+void gen_tac_end_arm()
+{
+	arm_depth--;
+
+	if(arm_deferred[arm_depth])
+	{
+		int i;
+		for(i = 0; i < num_deferred; i++)
+		{
+			if(deferred_arms[i] == arm_depth)
+			{
+				deferred_arms[i] = -1;
+			}
+		}
+	}
+	else
+	{
+		do_gen_else++;
+	}
+
+	return;
+}
+
+// Write out the if lines of all held back ?s
+// Needed once their if/elses can't be lowered to selects
+void open_deferred_ifs()
+{
+	int i;
+	for(i = 0; i < num_deferred; i++)
+	{
+		write_tac("if(%s) {\n", deferred_conds[i]);
+		release_name(deferred_conds[i]);
+
+		if(deferred_arms[i] == -1)
+		{
+			do_gen_else++;
+		}
+		else
+		{
+			arm_deferred[deferred_arms[i]] = 0;	// Counted when its arm ends
+		}
+	}
+
+	num_deferred = 0;
+
+	return;
+}
+
+// Assign var the value if all held back ? conditions are true, otherwise 0
+// if(c) { x = v; } else { x = 0; } becomes x = c ? v; (nested ?s select through temps)
+void gen_tac_select(char * var, char * value)
+{
+	char * selected = value;
+	int i;
+	for(i = num_deferred - 1; i > 0; i--)
+	{
+		char * temp = gen_tac_expr(deferred_conds[i], "?", selected);
+		release_name(deferred_conds[i]);
+		if(selected != value)
+		{
+			release_name(selected);
+		}
+		selected = temp;
+	}
+
+	write_tac("%s = %s ? %s;\n", var, deferred_conds[0], selected);
+	release_name(deferred_conds[0]);
+	if(selected != value)
+	{
+		release_name(selected);
+	}
+
+	num_deferred = 0;
+
+	return;
+}
+
+// Print out closing brace of if statement and the whole else statement
+// else will be a variable being assigned to a value of zero
+void gen_tac_assign_else(char * expr)
+{
+	for (; do_gen_else > 0; do_gen_else--)
+	{
+		write_tac("} else {\n%s = 0;\n}\n", expr);
+	}
+
+	return;
+}
+
+// If the result of the conditional expression is not being written to a variable
+// the else part will be empty
+// Held back ?s have nothing left under them and are dropped
+void gen_tac_empty_else()
+{
+	for (; num_deferred > 0; num_deferred--)
+	{
+		release_name(deferred_conds[num_deferred - 1]);
+	}
+
+	for (; do_gen_else > 0; do_gen_else--)
+	{
+		write_tac("} else {\n}\n");
+	}
+
+	return;
+}
+
+// Records all first appearances of user variables for use in C code generation
+// If variable is not being defined and hasn't been used before, add it to list of uninitialized variables
+void track_user_var(char *var, int assigned)
+{
+	// Check if variable has been recorded before
+	int i;
+	for(i = 0; i < num_user_vars; i++)
+	{
+		if(strcmp(user_vars[i], var) == 0)
+		{
+			return; // If the variable was already recorded, don't need to record it again
+		}
+	}
+
+	// Check if variable is valid
+	if(num_user_vars >= MAX_USR_NUM_VARS)
+	{
+		yyerror("Max number of user variables reached");
+		exit(1);	// Exit since variable (and therefor the entire program) is not valid
+	}
+	else if (strlen(var) > MAX_USR_VAR_NAME_LEN)
+	{
+		yyerror("Variable name too long");
+		exit(1); 	// Exit since variable (and therefor the entire program) is not valid
+	}
+
+	// If the variable hasn't been seen before, need to record its first appearance
+	if(!assigned)	// If variable is not being assigned a value, then it's first use is without a definition
+	{
+		strcpy(user_vars_wo_def[num_user_vars_wo_def], var);
+		num_user_vars_wo_def++;
+	}
+
+	strcpy(user_vars[num_user_vars], var);
+	num_user_vars++;
+
+	return;
+}
+
+// Copy a whole file to the end of an open file
+void append_file(char * input, FILE * output)
+{
+	FILE * input_file = calc_fopen(input, "r");
+	if (input_file == NULL)
+	{
+		yyerror("Couldn't open file for copying");
+		exit(1);
+	}
+
+	char buf[4096];
+	size_t len;
+	while((len = fread(buf, 1, sizeof(buf), input_file)) > 0)
+	{
+		fwrite(buf, 1, len, output);
+	}
+
+	fclose(input_file);
+
+	return;
+}
+
+// Streaming mode: allocate registers for the statements parsed since the last
+// region, write out their TAC, then start a new region
+// Only user variables carry values between statements and they're always in
+// memory at region boundaries, so each region can be allocated on its own
+// With the compile cache on, a region whose TAC was allocated before reuses that register TAC
+void compile_window()
+{
+	fclose(tac_file);
+
+	char * alloc_tac_name = window_tac_name;
+	if (do_schedule)
+	{
+		num_temp_vars = schedule_tac(window_tac_name, window_sched_tac_name, num_temp_vars);
+		append_file(window_sched_tac_name, sched_tac_file);
+		alloc_tac_name = window_sched_tac_name;
+	}
+
+	if (cache_dir_name == NULL)
+	{
+		allocate_registers_region(alloc_tac_name, reg_tac_file, alloc_mode);
+	}
+	else
+	{
+		unsigned long long region_key = cache_hash_file(alloc_tac_name, region_key_start);
+		if (!cache_fetch_append(region_key, "-region.txt", reg_tac_file))
+		{
+			FILE * window_reg_tac_file = calc_fopen(window_reg_tac_name, "w");
+			if (window_reg_tac_file == NULL)
+			{
+				yyerror("Couldn't create register TAC window file");
+				exit(1);
+			}
+
+			allocate_registers_region(alloc_tac_name, window_reg_tac_file, alloc_mode);
+			fclose(window_reg_tac_file);
+
+			cache_store(region_key, "-region.txt", window_reg_tac_name);
+			append_file(window_reg_tac_name, reg_tac_file);
+		}
+	}
+	fflush(reg_tac_file);
+
+	append_file(window_tac_name, frontend_tac_file);
+
+	tac_file = calc_fopen(window_tac_name, "w");
+	if (tac_file == NULL)
+	{
+		yyerror("Couldn't create TAC window file");
+		exit(1);
+	}
+
+	window_statements = 0;
+
+	return;
+}
+
+// Called after each statement; compiles the current region when it ends here
+// The if/elses of a statement are always closed by the end of it
+// A region ends after a statement whose TAC hashes to a multiple of the window
+// size (about one in stream_window), or once it has stream_window statements.
+// Statement TAC doesn't depend on where the statement is (temps are numbered
+// per statement), so adding or removing statements only moves the boundaries
+// up to the next picked statement, and the regions past it hit in the compile cache
+void end_statement()
+{
+	if (stream_window > 0)
+	{
+		window_statements++;
+		if (statement_hash % stream_window == 0 || window_statements >= stream_window)
+		{
+			compile_window();
+		}
+		statement_hash = CACHE_HASH_START;
+	}
+
+	return;
+}
+
+// Copy a whole program's outputs from the compile cache
+// Returns 0 if they aren't all cached (the frontend TAC is stored last and evicted
+// first, so its entry marks a complete set; it's fetched last in case the set is
+// evicted meanwhile)
+int fetch_cached_outputs()
+{
+	if (!cache_has(program_key, CACHE_MARKER_SUFFIX))
+	{
+		return 0;
+	}
+
+	if (!cache_fetch(program_key, "-reg.txt", reg_tac_file_name)
+	|| !cache_fetch(program_key, "-opt.txt", opt_reg_tac_file_name)
+	|| (do_schedule && !cache_fetch(program_key, "-sched.txt", sched_tac_file_name))
+	|| !cache_fetch(program_key, "-c.c", "Output/c-backend.c")
+	|| !cache_fetch(program_key, "-c-reg.c", "Output/c-reg-backend.c")
+	|| (gen_batch && !cache_fetch(program_key, "-c-batch.c", "Output/c-batch-backend.c")))
+	{
+		return 0;
+	}
+	if (gen_driver)
+	{
+		cache_fetch(program_key, "-c-driver.c", "Output/c-driver-backend.c");	// Not generated for programs without inputs
+	}
+
+	return cache_fetch(program_key, CACHE_MARKER_SUFFIX, frontend_tac_name);
+}
+
+// Save a whole program's outputs in the compile cache
+void store_cached_outputs()
+{
+	cache_store(program_key, "-reg.txt", reg_tac_file_name);
+	cache_store(program_key, "-opt.txt", opt_reg_tac_file_name);
+	if (do_schedule)
+	{
+		cache_store(program_key, "-sched.txt", sched_tac_file_name);
+	}
+	cache_store(program_key, "-c.c", "Output/c-backend.c");
+	cache_store(program_key, "-c-reg.c", "Output/c-reg-backend.c");
+	if (gen_batch)
+	{
+		cache_store(program_key, "-c-batch.c", "Output/c-batch-backend.c");
+	}
+	if (gen_driver && num_user_vars_wo_def > 0)
+	{
+		cache_store(program_key, "-c-driver.c", "Output/c-driver-backend.c");
+	}
+	cache_store(program_key, CACHE_MARKER_SUFFIX, frontend_tac_name);
+
+	return;
+}
+
+// Convert a TAC assignment line into C in place
+// Lines with ** or ! are replaced with calc_ipow or ~, selects get their 0
+void convert_tac_line(char * line_buf)
+{
+	char *bitwise = strstr(line_buf, "!");
+	char *pow = strstr(line_buf, "**");
+	char *select = strstr(line_buf, " ? ");
+
+	if(bitwise != NULL) 		// Replace ! with ~
+	{
+		*bitwise = '~';
+	}
+	else if(select != NULL)		// Add the 0 of x = c ? v;
+	{
+		strcpy(strchr(line_buf, ';'), " : 0;\n");
+	}
+	else if(pow != NULL)		// Split up the line with a ** and reformat it with a calc_ipow() call
+	{
+		char temp[MAX_USR_VAR_NAME_LEN * 4];
+		strcpy(temp, line_buf);
+
+		char *first = strtok(temp, " =*;");		// Lines with ** will always have 3 operands
+		char *second = strtok(NULL, " =*;");
+		char *third = strtok(NULL, " =*;");
+
+		sprintf(line_buf, "%s = calc_ipow(%s, %s);\n", first, second, third);
+	}
+
+	return;
+}
+
+// Write the integer power function every C backend uses for **, so they all agree
+// Branch free; runs through all the exponent's bits unrolled (no inner loop) so
+// the batch backend's loop calling it can be vectorized
+// Results wrap around like the other int operators do. Negative exponents round
+// toward zero (only bases 1 and -1 give a non zero result), so 0 ** -n is 0
+void gen_c_ipow()
+{
+	fprintf(c_code_file, "static inline int calc_ipow(int base, int exp)\n{\n");
+	fprintf(c_code_file, "\tunsigned int result = 1, b = (unsigned int)base, e = (unsigned int)exp;\n");
+
+	int i;
+	for (i = 0; i < 31; i++)
+	{
+		fprintf(c_code_file, "\tresult *= (e & 1) ? b : 1; b *= b; e >>= 1;\n");
+	}
+	fprintf(c_code_file, "\tint neg_result = base == 1 ? 1 : (base == -1 ? ((exp & 1) ? -1 : 1) : 0);\n");
+	fprintf(c_code_file, "\treturn exp < 0 ? neg_result : (int)result;\n}\n\n");
+
+	return;
+}
+
+// Take the TAC and generate a valid C program code
+void gen_c_code(char * input, char * output, int regs)
+{
+	// Open files for reading TAC and writing C code
+	tac_file = calc_fopen(input, "r");
+	c_code_file = calc_fopen(output, "w");
+	if (tac_file == NULL)
+	{
+		yyerror("Couldn't open TAC file in C code generation step");
+		exit(1);
+	}
+	if (c_code_file == NULL)
+	{
+		yyerror("Couldn't create C code output file");
+		exit(1);
+	}
+
+	int i;
+	fprintf(c_code_file, "#include <stdio.h>\n#include <math.h>\n\n");
+	gen_c_ipow();
+	fprintf(c_code_file, "int main() {\n");
+
+	// Declare all user variables and initialize them to 0
+	if (num_user_vars > 0)
+	{
+		fprintf(c_code_file, "\tint ");
+	}
+	for(i = 0; i < num_user_vars; i++)
+	{
+		if (i != num_user_vars - 1)
+		{
+			fprintf(c_code_file, "%s = 0, ", user_vars[i]);
+		}
+		else
+		{
+			fprintf(c_code_file, "%s = 0;\n", user_vars[i]);
+		}
+	}
+
+	// Declare all temp variables and initialize them to 0
+	if (num_temp_vars > 0)
+	{
+		fprintf(c_code_file, "\tint ");
+	}
+	for(i = 0; i < num_temp_vars; i++)
+	{
+		if(i < num_temp_vars - 1)
+		{
+			fprintf(c_code_file, "_t%d = 0, ", i);
+		}
+		else
+		{
+			fprintf(c_code_file, "_t%d = 0;\n", i);
+		}
+	}
+
+	// Create register variables
+	if(regs)
+	{
+		fprintf(c_code_file, "\tint ");
+		for(i = 0; i < NUM_REG; i++)
+		{
+			if(i < NUM_REG - 1)
+			{
+				fprintf(c_code_file, "_r%d = 0, ", i + 1);
+			}
+			else
+			{
+				fprintf(c_code_file, "_r%d = 0;\n", i + 1);
+			}
+		}
+	}
+
+	fprintf(c_code_file, "\n");
+
+	// Initialize user variables not assigned (ask user input for variables)
+	for (i = 0; i < num_user_vars_wo_def; i++)
+	{
+		fprintf(c_code_file, "\tprintf(\"%s=\");\n", user_vars_wo_def[i]);
+		fprintf(c_code_file, "\tscanf(\"%%d\", &%s);\n\n", user_vars_wo_def[i]);
+	}
+
+	// Read in TAC file, write to c file with line labels
+	// Convert lines with ** or ! and replace with calc_ipow or ~
+	char line_buf[MAX_USR_VAR_NAME_LEN * 4];
+	i = 0;
+	while(fgets(line_buf, MAX_USR_VAR_NAME_LEN * 4, tac_file) != NULL)
+	{
+		// Don't print label if line is a closing } or else statement
+		if(strcmp(line_buf, "}\n") == 0 || strcmp(line_buf, "} else {\n") == 0)
+		{
+			fprintf(c_code_file, "\t\t\t%s", line_buf);
+			continue;
+		}
+
+		convert_tac_line(line_buf);
+
+		// Print c code line with line # label
+		if(i < 10)
+		{
+			fprintf(c_code_file, "\tS%d:\t\t%s", i, line_buf);
+		}
+		else
+		{
+			fprintf(c_code_file, "\tS%d:\t%s", i, line_buf);
+		}
+
+		i++;	// Increment line number
+	}
+
+	fprintf(c_code_file, "\n");
+
+	// Print out user variable final values
+	for(i = 0; i < num_user_vars; i++)
+	{
+		fprintf(c_code_file, "\tprintf(\"%s=%%d\\n\", %s);\n", user_vars[i], user_vars[i]);
+	}
+
+	fprintf(c_code_file, "\n\treturn 0;\n}\n");
+
+	// Close files from C code generation
+	fclose(tac_file);
+	fclose(c_code_file);
+
+	return;
+}
+
+// Helper function for gen_c_batch_code
+// Write out the C expression for the right hand side of a TAC assignment
+// ** becomes an integer power, ! becomes ~, selects get their 0
+// Under a mask (inside an if/else), a divisor is replaced with 1 for the elements
+// that don't take the branch since every element evaluates both branches
+void write_batch_rhs(char * rhs, char * mask)
+{
+	char temp[MAX_USR_VAR_NAME_LEN * 4];
+	strcpy(temp, rhs);
+
+	char * one = strtok(temp, " ;\n");
+	char * op = strtok(NULL, " ;\n");
+	char * three = strtok(NULL, " ;\n");
+
+	if (op == NULL)
+	{
+		if (one[0] == '!')
+		{
+			fprintf(c_code_file, "~%s", one + 1);
+		}
+		else
+		{
+			fprintf(c_code_file, "%s", one);
+		}
+	}
+	else if (strcmp(op, "**") == 0)
+	{
+		fprintf(c_code_file, "calc_ipow(%s, %s)", one, three);
+	}
+	else if (strcmp(op, "?") == 0)
+	{
+		fprintf(c_code_file, "(%s ? %s : 0)", one, three);
+	}
+	else if (strcmp(op, "/") == 0 && mask != NULL)
+	{
+		fprintf(c_code_file, "%s / (%s ? %s : 1)", one, mask, three);
+	}
+	else
+	{
+		fprintf(c_code_file, "%s %s %s", one, op, three);
+	}
+
+	return;
+}
+
+// Take the TAC and generate a C function that runs the program over arrays of inputs
+// Inputs are structure-of-arrays: one array for each user variable used without a
+// definition; every user variable's final value is written to its own output array
+// if/else statements are if-converted: both branches are evaluated for every element
+// and each assignment in them becomes a select on the branch mask, so the loop body
+// is straight-line and can be auto-vectorized (blends for the selects)
+void gen_c_batch_code(char * input, char * output)
+{
+	tac_file = calc_fopen(input, "r");
+	c_code_file = calc_fopen(output, "w");
+	if (tac_file == NULL)
+	{
+		yyerror("Couldn't open TAC file in batch C code generation step");
+		exit(1);
+	}
+	if (c_code_file == NULL)
+	{
+		yyerror("Couldn't create batch C code output file");
+		exit(1);
+	}
+
+	int i;
+	fprintf(c_code_file, "#include <stdio.h>\n\n");
+
+	gen_c_ipow();
+
+	// Function signature: element count, input arrays, output arrays
+	// Names that aren't user variables start with _ or contain one (user variables can't)
+	fprintf(c_code_file, "void calc_batch(int _n");
+	for (i = 0; i < num_user_vars_wo_def; i++)
+	{
+		fprintf(c_code_file, ", const int * restrict in_%s", user_vars_wo_def[i]);
+	}
+	for (i = 0; i < num_user_vars; i++)
+	{
+		fprintf(c_code_file, ", int * restrict out_%s", user_vars[i]);
+	}
+	fprintf(c_code_file, ")\n{\n\tint _i;\n\tfor (_i = 0; _i < _n; _i++)\n\t{\n");
+
+	// Load inputs; all other user variables and temps start at 0
+	int j;
+	for (i = 0; i < num_user_vars; i++)
+	{
+		int is_input = 0;
+		for (j = 0; j < num_user_vars_wo_def; j++)
+		{
+			if (strcmp(user_vars[i], user_vars_wo_def[j]) == 0)
+			{
+				is_input = 1;
+			}
+		}
+
+		if (is_input)
+		{
+			fprintf(c_code_file, "\t\tint %s = in_%s[_i];\n", user_vars[i], user_vars[i]);
+		}
+		else
+		{
+			fprintf(c_code_file, "\t\tint %s = 0;\n", user_vars[i]);
+		}
+	}
+	for (i = 0; i < num_temp_vars; i++)
+	{
+		fprintf(c_code_file, "\t\tint _t%d = 0;\n", i);
+	}
+	fprintf(c_code_file, "\n");
+
+	// Masks of the if/elses currently inside of
+	// Each if gets its own number k: _c<k> is its condition, _m<k> the if mask, _e<k> the else mask
+	// The mask active when an if starts is saved so it can be used again after its closing }
+	int if_ids[MAX_IF_DEPTH];
+	char saved_masks[MAX_IF_DEPTH][16];
+	int if_depth = 0;
+	int num_ifs = 0;
+	char mask[16] = "";		// Empty when not inside any if/else
+
+	char line_buf[MAX_USR_VAR_NAME_LEN * 4];
+	while(fgets(line_buf, MAX_USR_VAR_NAME_LEN * 4, tac_file) != NULL)
+	{
+		if (strncmp(line_buf, "if(", 3) == 0)
+		{
+			if (if_depth >= MAX_IF_DEPTH)
+			{
+				yyerror("Too many nested ifs for batch C code generation");
+				exit(1);
+			}
+
+			char * cond = strtok(line_buf + 3, ")");
+			fprintf(c_code_file, "\t\tconst int _c%d = (%s != 0);\n", num_ifs, cond);
+			if (mask[0] == '\0')
+			{
+				fprintf(c_code_file, "\t\tconst int _m%d = _c%d;\n", num_ifs, num_ifs);
+			}
+			else
+			{
+				fprintf(c_code_file, "\t\tconst int _m%d = %s & _c%d;\n", num_ifs, mask, num_ifs);
+			}
+
+			if_ids[if_depth] = num_ifs;
+			strcpy(saved_masks[if_depth], mask);
+			if_depth++;
+			sprintf(mask, "_m%d", num_ifs);
+			num_ifs++;
+		}
+		else if (strcmp(line_buf, "} else {\n") == 0)
+		{
+			int id = if_ids[if_depth - 1];
+			char * outer_mask = saved_masks[if_depth - 1];
+			if (outer_mask[0] == '\0')
+			{
+				fprintf(c_code_file, "\t\tconst int _e%d = !_c%d;\n", id, id);
+			}
+			else
+			{
+				fprintf(c_code_file, "\t\tconst int _e%d = %s & !_c%d;\n", id, outer_mask, id);
+			}
+			sprintf(mask, "_e%d", id);
+		}
+		else if (strcmp(line_buf, "}\n") == 0)
+		{
+			if_depth--;
+			strcpy(mask, saved_masks[if_depth]);
+		}
+		else	// Assignment
+		{
+			char * equals = strstr(line_buf, " = ");
+			*equals = '\0';
+			char * dest = line_buf;
+			char * rhs = equals + 3;
+
+			if (mask[0] == '\0')
+			{
+				fprintf(c_code_file, "\t\t%s = ", dest);
+				write_batch_rhs(rhs, NULL);
+				fprintf(c_code_file, ";\n");
+			}
+			else
+			{
+				fprintf(c_code_file, "\t\t%s = %s ? ", dest, mask);
+				write_batch_rhs(rhs, mask);
+				fprintf(c_code_file, " : %s;\n", dest);
+			}
+		}
+	}
+
+	// Write out final values of user variables
+	fprintf(c_code_file, "\n");
+	for (i = 0; i < num_user_vars; i++)
+	{
+		fprintf(c_code_file, "\t\tout_%s[_i] = %s;\n", user_vars[i], user_vars[i]);
+	}
+	fprintf(c_code_file, "\t}\n}\n");
+
+	// Optional main that runs one element read from stdin, same I/O as the scalar program
+	fprintf(c_code_file, "\n#ifdef CALC_BATCH_MAIN\nint main() {\n");
+	for (i = 0; i < num_user_vars_wo_def; i++)
+	{
+		fprintf(c_code_file, "\tint in_%s;\n", user_vars_wo_def[i]);
+		fprintf(c_code_file, "\tprintf(\"%s=\");\n", user_vars_wo_def[i]);
+		fprintf(c_code_file, "\tscanf(\"%%d\", &in_%s);\n", user_vars_wo_def[i]);
+	}
+	for (i = 0; i < num_user_vars; i++)
+	{
+		fprintf(c_code_file, "\tint out_%s;\n", user_vars[i]);
+	}
+	fprintf(c_code_file, "\n\tcalc_batch(1");
+	for (i = 0; i < num_user_vars_wo_def; i++)
+	{
+		fprintf(c_code_file, ", &in_%s", user_vars_wo_def[i]);
+	}
+	for (i = 0; i < num_user_vars; i++)
+	{
+		fprintf(c_code_file, ", &out_%s", user_vars[i]);
+	}
+	fprintf(c_code_file, ");\n\n");
+	for (i = 0; i < num_user_vars; i++)
+	{
+		fprintf(c_code_file, "\tprintf(\"%s=%%d\\n\", out_%s);\n", user_vars[i], user_vars[i]);
+	}
+	fprintf(c_code_file, "\n\treturn 0;\n}\n#endif\n");
+
+	fclose(tac_file);
+	fclose(c_code_file);
+
+	return;
+}
+
+// Take the register allocated TAC and generate a multi-threaded batch driver around it
+// The driver runs the program once per row of a binary input file: each row is one int
+// per user variable used without a definition (in order of first use), and each output row
+// is one int per user variable. Both files are memory mapped; rows are split into chunks
+// that run on a pool of threads, each owning a range of chunks and stealing from the others
+// once its own are done. Outputs are written straight into the mapped output file at their
+// row's position, so they stay in input order without any copying or merging
+void gen_c_driver_code(char * input, char * output)
+{
+	if (num_user_vars_wo_def == 0)
+	{
+		printf("Program reads no input variables, batch driver not generated\n");
+		return;
+	}
+
+	tac_file = calc_fopen(input, "r");
+	c_code_file = calc_fopen(output, "w");
+	if (tac_file == NULL)
+	{
+		yyerror("Couldn't open TAC file in batch driver generation step");
+		exit(1);
+	}
+	if (c_code_file == NULL)
+	{
+		yyerror("Couldn't create batch driver output file");
+		exit(1);
+	}
+
+	int i;
+	fprintf(c_code_file, "#include <fcntl.h>\n#include <pthread.h>\n#include <stdio.h>\n#include <stdlib.h>\n");
+	fprintf(c_code_file, "#include <sys/mman.h>\n#include <sys/stat.h>\n#include <time.h>\n#include <unistd.h>\n\n");
+	fprintf(c_code_file, "#define NUM_INPUTS\t%d\t\t// Ints per input row\n", num_user_vars_wo_def);
+	fprintf(c_code_file, "#define NUM_OUTPUTS\t%d\t\t// Ints per output row\n", num_user_vars);
+	fprintf(c_code_file, "#define CHUNK_ROWS\t%d\t// Rows evaluated per unit of work\n", DRIVER_CHUNK_ROWS);
+	fprintf(c_code_file, "#define MAX_THREADS\t%d\n\n", DRIVER_MAX_THREADS);
+
+	gen_c_ipow();
+
+	// Program body for a single row, from the register TAC
+	fprintf(c_code_file, "static void calc_row(const int * restrict _in, int * restrict _out)\n{\n");
+	fprintf(c_code_file, "\tint ");
+	for (i = 0; i < num_user_vars; i++)
+	{
+		fprintf(c_code_file, "%s = 0, ", user_vars[i]);
+	}
+	for (i = 0; i < num_temp_vars; i++)
+	{
+		fprintf(c_code_file, "_t%d = 0, ", i);
+	}
+	for (i = 0; i < NUM_REG; i++)
+	{
+		fprintf(c_code_file, "_r%d = 0%s", i + 1, i < NUM_REG - 1 ? ", " : ";\n\n");
+	}
+	for (i = 0; i < num_user_vars_wo_def; i++)
+	{
+		fprintf(c_code_file, "\t%s = _in[%d];\n", user_vars_wo_def[i], i);
+	}
+	fprintf(c_code_file, "\n");
+
+	char line_buf[MAX_USR_VAR_NAME_LEN * 4];
+	while(fgets(line_buf, MAX_USR_VAR_NAME_LEN * 4, tac_file) != NULL)
+	{
+		convert_tac_line(line_buf);
+		fprintf(c_code_file, "\t%s", line_buf);
+	}
+
+	fprintf(c_code_file, "\n");
+	for (i = 0; i < num_user_vars; i++)
+	{
+		fprintf(c_code_file, "\t_out[%d] = %s;\n", i, user_vars[i]);
+	}
+	fprintf(c_code_file, "}\n\n");
+
+	// Work queues: the owner takes chunks from the front, thieves from the back
+	fprintf(c_code_file,
+		"typedef struct\n"
+		"{\n"
+		"\tpthread_mutex_t lock;\n"
+		"\tlong next;\t\t// Next chunk the owner runs\n"
+		"\tlong end;\t\t// One past the last chunk left; thieves take end - 1\n"
+		"} Chunk_Queue;\n\n"
+		"static Chunk_Queue queues[MAX_THREADS];\n"
+		"static int num_threads;\n"
+		"static long num_rows;\n"
+		"static const int * in_rows;\n"
+		"static int * out_rows;\n\n");
+
+	fprintf(c_code_file,
+		"static long take_chunk(int queue, int steal)\n"
+		"{\n"
+		"\tlong chunk = -1;\n"
+		"\tpthread_mutex_lock(&queues[queue].lock);\n"
+		"\tif (queues[queue].next < queues[queue].end)\n"
+		"\t{\n"
+		"\t\tchunk = steal ? --queues[queue].end : queues[queue].next++;\n"
+		"\t}\n"
+		"\tpthread_mutex_unlock(&queues[queue].lock);\n"
+		"\treturn chunk;\n"
+		"}\n\n");
+
+	fprintf(c_code_file,
+		"static void run_chunk(long chunk)\n"
+		"{\n"
+		"\tlong row = chunk * CHUNK_ROWS;\n"
+		"\tlong last = row + CHUNK_ROWS < num_rows ? row + CHUNK_ROWS : num_rows;\n"
+		"\tfor (; row < last; row++)\n"
+		"\t{\n"
+		"\t\tcalc_row(in_rows + row * NUM_INPUTS, out_rows + row * NUM_OUTPUTS);\n"
+		"\t}\n"
+		"}\n\n");
+
+	// No chunks are ever added, so a queue found empty stays empty
+	fprintf(c_code_file,
+		"static void * worker(void * arg)\n"
+		"{\n"
+		"\tint id = (int)(long)arg;\n"
+		"\tlong chunk;\n"
+		"\tint i;\n"
+		"\twhile ((chunk = take_chunk(id, 0)) >= 0)\n"
+		"\t{\n"
+		"\t\trun_chunk(chunk);\n"
+		"\t}\n"
+		"\tfor (i = 1; i < num_threads; i++)\n"
+		"\t{\n"
+		"\t\tint victim = (id + i) %% num_threads;\n"
+		"\t\twhile ((chunk = take_chunk(victim, 1)) >= 0)\n"
+		"\t\t{\n"
+		"\t\t\trun_chunk(chunk);\n"
+		"\t\t}\n"
+		"\t}\n"
+		"\treturn NULL;\n"
+		"}\n\n");
+
+	// main: map the files, hand out the chunks, run the pool, report throughput
+	fprintf(c_code_file,
+		"int main(int argc, char *argv[])\n"
+		"{\n"
+		"\tif (argc < 3)\n"
+		"\t{\n"
+		"\t\tprintf(\"Usage: %%s input_rows output_rows [threads]\\n\", argv[0]);\n"
+		"\t\tprintf(\"  input_rows:  binary file of packed native ints, %%d per row\\n\", NUM_INPUTS);\n"
+		"\t\tprintf(\"  output_rows: written in the same format, %%d ints per row\\n\", NUM_OUTPUTS);\n"
+		"\t\treturn 1;\n"
+		"\t}\n\n"
+		"\tnum_threads = argc > 3 ? atoi(argv[3]) : (int)sysconf(_SC_NPROCESSORS_ONLN);\n"
+		"\tif (num_threads < 1 || num_threads > MAX_THREADS)\n"
+		"\t{\n"
+		"\t\tprintf(\"Thread count must be between 1 and %%d\\n\", MAX_THREADS);\n"
+		"\t\treturn 1;\n"
+		"\t}\n\n"
+		"\tint in_fd = open(argv[1], O_RDONLY);\n"
+		"\tstruct stat in_stat;\n"
+		"\tif (in_fd < 0 || fstat(in_fd, &in_stat) != 0)\n"
+		"\t{\n"
+		"\t\tprintf(\"Couldn't open input file %%s\\n\", argv[1]);\n"
+		"\t\treturn 1;\n"
+		"\t}\n"
+		"\tif (in_stat.st_size %% (NUM_INPUTS * sizeof(int)) != 0)\n"
+		"\t{\n"
+		"\t\tprintf(\"Input file size is not a multiple of the row size (%%d ints)\\n\", NUM_INPUTS);\n"
+		"\t\treturn 1;\n"
+		"\t}\n"
+		"\tnum_rows = in_stat.st_size / (NUM_INPUTS * sizeof(int));\n"
+		"\tsize_t out_size = num_rows * NUM_OUTPUTS * sizeof(int);\n\n"
+		"\tint out_fd = open(argv[2], O_RDWR | O_CREAT | O_TRUNC, 0644);\n"
+		"\tif (out_fd < 0 || ftruncate(out_fd, out_size) != 0)\n"
+		"\t{\n"
+		"\t\tprintf(\"Couldn't create output file %%s\\n\", argv[2]);\n"
+		"\t\treturn 1;\n"
+		"\t}\n\n"
+		"\tif (num_rows > 0)\n"
+		"\t{\n"
+		"\t\tin_rows = mmap(NULL, in_stat.st_size, PROT_READ, MAP_PRIVATE, in_fd, 0);\n"
+		"\t\tout_rows = mmap(NULL, out_size, PROT_READ | PROT_WRITE, MAP_SHARED, out_fd, 0);\n"
+		"\t\tif (in_rows == MAP_FAILED || out_rows == MAP_FAILED)\n"
+		"\t\t{\n"
+		"\t\t\tprintf(\"Couldn't map input or output file\\n\");\n"
+		"\t\t\treturn 1;\n"
+		"\t\t}\n"
+		"\t\tmadvise((void *)in_rows, in_stat.st_size, MADV_SEQUENTIAL);\n"
+		"\t}\n\n"
+		"\t// Each thread starts with an equal share of the chunks\n"
+		"\tlong num_chunks = (num_rows + CHUNK_ROWS - 1) / CHUNK_ROWS;\n"
+		"\tint i;\n"
+		"\tfor (i = 0; i < num_threads; i++)\n"
+		"\t{\n"
+		"\t\tpthread_mutex_init(&queues[i].lock, NULL);\n"
+		"\t\tqueues[i].next = num_chunks * i / num_threads;\n"
+		"\t\tqueues[i].end = num_chunks * (i + 1) / num_threads;\n"
+		"\t}\n\n"
+		"\tstruct timespec start, stop;\n"
+		"\tclock_gettime(CLOCK_MONOTONIC, &start);\n\n"
+		"\tpthread_t threads[MAX_THREADS];\n"
+		"\tfor (i = 1; i < num_threads; i++)\n"
+		"\t{\n"
+		"\t\tpthread_create(&threads[i], NULL, worker, (void *)(long)i);\n"
+		"\t}\n"
+		"\tworker((void *)0);\n"
+		"\tfor (i = 1; i < num_threads; i++)\n"
+		"\t{\n"
+		"\t\tpthread_join(threads[i], NULL);\n"
+		"\t}\n\n"
+		"\tclock_gettime(CLOCK_MONOTONIC, &stop);\n"
+		"\tdouble seconds = (stop.tv_sec - start.tv_sec) + (stop.tv_nsec - start.tv_nsec) / 1e9;\n\n"
+		"\tif (num_rows > 0)\n"
+		"\t{\n"
+		"\t\tmunmap((void *)in_rows, in_stat.st_size);\n"
+		"\t\tmunmap(out_rows, out_size);\n"
+		"\t}\n"
+		"\tclose(in_fd);\n"
+		"\tclose(out_fd);\n\n"
+		"\tprintf(\"%%ld rows in %%.3f s on %%d threads (%%.0f rows/s)\\n\", num_rows, seconds, num_threads,\n"
+		"\t\tseconds > 0 ? num_rows / seconds : 0.0);\n\n"
+		"\treturn 0;\n"
+		"}\n");
+
+	fclose(tac_file);
+	fclose(c_code_file);
+
+	return;
+}
+
+void yyerror(const char *s)
+{
+	printf("%s\n", s);
+}
+
+// Compile a program; takes the same arguments as calc itself
+// Returns calc's exit status
+int compile(int argc, char *argv[])
+{
+	// Read in options; the input program file is always the last argument
+	// -interval: allocate registers by coloring the interval graph of the split live ranges instead of with the heuristic
+	// -stream N: allocate registers and write out register TAC in regions of at most N statements
+	// -batch: also generate C code that runs the program over arrays of inputs
+	// -driver: also generate a multi-threaded program that runs the program over a file of input rows
+	// -cache DIR: reuse outputs (and, when streaming, region register TAC) compiled before, kept in DIR
+	// -sched: list schedule each straight-line block of the TAC before allocating registers
+	int i;
+	for (i = 1; i < argc - 1; i++)
+	{
+		if (strcmp(argv[i], "-interval") == 0)
+		{
+			alloc_mode = ALLOC_INTERVAL;
+		}
+		else if (strcmp(argv[i], "-sched") == 0)
+		{
+			do_schedule = 1;
+		}
+		else if (strcmp(argv[i], "-batch") == 0)
+		{
+			gen_batch = 1;
+		}
+		else if (strcmp(argv[i], "-driver") == 0)
+		{
+			gen_driver = 1;
+		}
+		else if (strcmp(argv[i], "-cache") == 0 && i + 1 < argc - 1)
+		{
+			cache_dir_name = argv[i + 1];
+			i++;
+		}
+		else if (strcmp(argv[i], "-stream") == 0 && i + 1 < argc - 1 && atoi(argv[i + 1]) > 0)
+		{
+			stream_window = atoi(argv[i + 1]);
+			i++;
+		}
+		else
+		{
+			yyerror("Unknown option (usage: calc [-interval] [-sched] [-stream N] [-batch] [-driver] [-cache DIR] input_file)");
+			exit(1);
+		}
+	}
+
+	// Open the input program file
+	if (argc < 2)
+	{
+		yyerror("Need to provide input file");
+		exit(1);
+	}
+	else
+	{
+		yyin = calc_fopen(argv[argc - 1], "r");
+		if(yyin == NULL)
+		{
+			yyerror("Couldn't open input file");
+			exit(1);
+		}
+	}
+
+	// Look for the program in the compile cache
+	// Region keys cover what register allocation depends on, the program key covers everything
+	if (cache_dir_name != NULL)
+	{
+		cache_open(cache_dir_name);
+
+		region_key_start = cache_hash_int(CACHE_VERSION, CACHE_HASH_START);
+		region_key_start = cache_hash_int(NUM_REG, region_key_start);
+		region_key_start = cache_hash_int(alloc_mode, region_key_start);
+		region_key_start = cache_hash_int(do_schedule, region_key_start);
+
+		program_key = cache_hash_file(argv[argc - 1], region_key_start);
+		program_key = cache_hash_int(stream_window, program_key);
+		program_key = cache_hash_int(gen_batch, program_key);
+		program_key = cache_hash_int(gen_driver, program_key);
+
+		if (fetch_cached_outputs())
+		{
+			printf("Compile cache hit (%016llx)\n", program_key);
+			fclose(yyin);
+			return 0;
+		}
+	}
+
+	// Open the output file where the three address codes will be written
+	// When streaming, each region's TAC goes to its own file first
+	if (stream_window > 0)
+	{
+		tac_file = calc_fopen(window_tac_name, "w");
+		frontend_tac_file = calc_fopen(frontend_tac_name, "w");
+		reg_tac_file = calc_fopen(reg_tac_file_name, "w");
+		sched_tac_file = do_schedule ? calc_fopen(sched_tac_file_name, "w") : NULL;
+
+		if (frontend_tac_file == NULL || reg_tac_file == NULL || (do_schedule && sched_tac_file == NULL))
+		{
+			yyerror("Couldn't create TAC file");
+			exit(1);
+		}
+	}
+	else
+	{
+		tac_file = calc_fopen(frontend_tac_name, "w");
+	}
+
+	if (tac_file == NULL)
+	{
 		yyerror("Couldn't create TAC file");
 		exit(1);
 	}
 
 	yyparse();	// Read in the input program and parse the tokens
 
-	// Close the files from initial TAC generation
 	fclose(yyin);
-	fclose(tac_file);
 
-	char * reg_tac_file_name = "Output/tac-reg-alloc.txt";
-	allocate_registers(frontend_tac_name, reg_tac_file_name);			// Take input TAC and allocate registers, output new TAC
-	
-	char * opt_reg_tac_file_name = "Output/opt-tac-reg-alloc.txt";
-	remove_self_assignment(reg_tac_file_name, opt_reg_tac_file_name);	// Remove useless self assignment lines from TAC
+	if (stream_window > 0)
+	{
+		compile_window();	// Last (partial) region
+
+		// Close the files from TAC generation and register allocation
+		fclose(tac_file);
+		fclose(frontend_tac_file);
+		fclose(reg_tac_file);
+		calc_remove(window_tac_name);
+		if (do_schedule)
+		{
+			fclose(sched_tac_file);
+			calc_remove(window_sched_tac_name);
+		}
+	}
+	else
+	{
+		// Close the files from initial TAC generation
+		fclose(tac_file);
+
+		if (do_schedule)
+		{
+			num_temp_vars = schedule_tac(frontend_tac_name, sched_tac_file_name, num_temp_vars);	// Interleave independent TAC within each block
+			allocate_registers(sched_tac_file_name, reg_tac_file_name, alloc_mode);				// Take scheduled TAC and allocate registers, output new TAC
+		}
+		else
+		{
+			allocate_registers(frontend_tac_name, reg_tac_file_name, alloc_mode);	// Take input TAC and allocate registers, output new TAC
+		}
+	}
+
+	peephole_optimize(reg_tac_file_name, opt_reg_tac_file_name);		// Remove useless copies, spills and reloads from TAC
 	
 	gen_c_code(frontend_tac_name, "Output/c-backend.c", 0);				// Generate C code from initial TAC (has not regs)
 	gen_c_code(opt_reg_tac_file_name, "Output/c-reg-backend.c", 1); 	// Generate C code from optimized register alloc TAC
 
+	if (gen_batch)
+	{
+		gen_c_batch_code(frontend_tac_name, "Output/c-batch-backend.c");	// Generate batch evaluation C code from initial TAC
+	}
+
+	if (gen_driver)
+	{
+		gen_c_driver_code(opt_reg_tac_file_name, "Output/c-driver-backend.c");	// Generate threaded batch driver from optimized register alloc TAC
+	}
+
+	if (cache_dir_name != NULL)
+	{
+		store_cached_outputs();
+		calc_remove(window_reg_tac_name);
+		cache_trim();
+	}
+
 	return 0;
 }
+
+int main(int argc, char *argv[])
+{
+	// -server: compile requests read from stdin, or from a UNIX socket if a path follows (see server.c)
+	if (argc >= 2 && strcmp(argv[1], "-server") == 0)
+	{
+		return run_server(argc > 2 ? argv[2] : NULL);
+	}
+
+	return compile(argc, argv);
+}
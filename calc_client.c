@@ -0,0 +1,189 @@
+// Thin client for the compile server (calc -server socket_path)
+// Takes the same arguments as calc and writes the same output files, but the
+// compile itself happens in the already running server
+// Usage: calc-client [-socket path] [calc options] input_file
+
+#include "protocol.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Read the whole input program
+char * read_program(char * file_name, size_t * size)
+{
+	FILE * file = fopen(file_name, "rb");
+	if(file == NULL)
+	{
+		printf("Couldn't open input file\n");
+		exit(1);
+	}
+
+	fseek(file, 0, SEEK_END);
+	*size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	char * program = malloc(*size + 1);
+	if(program == NULL || fread(program, 1, *size, file) != *size)
+	{
+		printf("Couldn't read input file\n");
+		exit(1);
+	}
+
+	fclose(file);
+
+	return program;
+}
+
+// Read the contents after a response header
+char * read_contents(int fd, size_t size)
+{
+	char * data = malloc(size + 1);
+	if(data == NULL || !read_all(fd, data, size))
+	{
+		printf("Compile server response cut off\n");
+		exit(1);
+	}
+
+	return data;
+}
+
+// Next field of a response header line
+char * next_field()
+{
+	char * field = strtok(NULL, " ");
+	if(field == NULL)
+	{
+		printf("Compile server response cut off\n");
+		exit(1);
+	}
+
+	return field;
+}
+
+// Only write a file the server names if it's directly in the output directory,
+// so a bad response can't write anywhere else
+int valid_output_name(char * name)
+{
+	size_t dir_len = strlen(SERVER_OUTPUT_DIR);
+	if(strncmp(name, SERVER_OUTPUT_DIR, dir_len) != 0)
+	{
+		return 0;
+	}
+
+	char * base = name + dir_len;
+	if(base[0] == '\0' || strchr(base, '/') != NULL || strcmp(base, ".") == 0 || strcmp(base, "..") == 0)
+	{
+		return 0;
+	}
+
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	char * socket_path = SERVER_SOCKET_PATH;
+	int first_option = 1;
+	if(argc > 2 && strcmp(argv[1], "-socket") == 0)
+	{
+		socket_path = argv[2];
+		first_option = 3;
+	}
+
+	if(argc - first_option < 1)
+	{
+		printf("Need to provide input file\n");
+		exit(1);
+	}
+
+	size_t program_size;
+	char * program = read_program(argv[argc - 1], &program_size);
+
+	// Request header: length of the program then calc's options as they were given
+	char header[MAX_FRAME_LINE_LEN];
+	int len = sprintf(header, "COMPILE %zu", program_size);
+	int i;
+	for(i = first_option; i < argc - 1; i++)
+	{
+		if(len + strlen(argv[i]) + 2 >= MAX_FRAME_LINE_LEN)
+		{
+			printf("Too many options\n");
+			exit(1);
+		}
+		len += sprintf(header + len, " %s", argv[i]);
+	}
+	strcat(header, "\n");
+
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, socket_path, sizeof(address.sun_path) - 1);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0 || connect(fd, (struct sockaddr *) &address, sizeof(address)) != 0)
+	{
+		printf("Couldn't connect to compile server at %s\n", socket_path);
+		exit(1);
+	}
+
+	if(!write_all(fd, header, strlen(header)) || !write_all(fd, program, program_size))
+	{
+		printf("Couldn't send request to compile server\n");
+		exit(1);
+	}
+
+	// Write out the files and the log until the end of the response
+	char line[MAX_FRAME_LINE_LEN];
+	while(read_line(fd, line, MAX_FRAME_LINE_LEN) >= 0)
+	{
+		char * kind = strtok(line, " ");
+		if(kind == NULL)
+		{
+			printf("Compile server response cut off\n");
+			exit(1);
+		}
+
+		if(strcmp(kind, "FILE") == 0)
+		{
+			char * name = next_field();
+			size_t size = strtoul(next_field(), NULL, 10);
+			if(!valid_output_name(name))
+			{
+				printf("Compile server sent a file outside %s: %s\n", SERVER_OUTPUT_DIR, name);
+				exit(1);
+			}
+			char * data = read_contents(fd, size);
+
+			FILE * file = fopen(name, "wb");
+			if(file == NULL)
+			{
+				printf("Couldn't create %s\n", name);
+				exit(1);
+			}
+			fwrite(data, 1, size, file);
+			fclose(file);
+			free(data);
+		}
+		else if(strcmp(kind, "LOG") == 0)
+		{
+			size_t size = strtoul(next_field(), NULL, 10);
+			char * data = read_contents(fd, size);
+			fwrite(data, 1, size, stdout);
+			free(data);
+		}
+		else if(strcmp(kind, "END") == 0)
+		{
+			int status = atoi(next_field());
+			long latency = atol(next_field());
+			printf("Compiled by server in %ld us\n", latency);
+			close(fd);
+			return status;
+		}
+	}
+
+	printf("Compile server closed the connection\n");
+
+	return 1;
+}
@@ -0,0 +1,171 @@
+#include "files.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Files the compiler passes between its stages
+// Normally these are real files (under Output/). In server mode they're kept
+// in memory instead: writing uses open_memstream and reading uses fmemopen,
+// so every stage works on a FILE * just as it does with a real file
+
+typedef struct memory_file
+{
+	char name[MAX_MEM_FILE_NAME_LEN + 1];
+	char * data;						// Contents (kept up to date by open_memstream on fflush/fclose)
+	size_t size;
+	int used;
+} Memory_File;
+
+int memory_files = 0;						// Set when files are kept in memory
+Memory_File file_table[MAX_MEM_FILES];
+
+// Keep all files in memory from now on
+void use_memory_files()
+{
+	memory_files = 1;
+
+	return;
+}
+
+// Find a file in memory, creating it when create is set
+Memory_File * find_memory_file(const char * name, int create)
+{
+	Memory_File * free_slot = NULL;
+	int i;
+	for(i = 0; i < MAX_MEM_FILES; i++)
+	{
+		if(file_table[i].used && strcmp(file_table[i].name, name) == 0)
+		{
+			return &file_table[i];
+		}
+		if(!file_table[i].used && free_slot == NULL)
+		{
+			free_slot = &file_table[i];
+		}
+	}
+
+	if(!create)
+	{
+		return NULL;
+	}
+
+	if(free_slot == NULL || strlen(name) > MAX_MEM_FILE_NAME_LEN)
+	{
+		printf("Unable to keep %s in memory\n", name);
+		exit(1);
+	}
+
+	strcpy(free_slot->name, name);
+	free_slot->data = NULL;
+	free_slot->size = 0;
+	free_slot->used = 1;
+
+	return free_slot;
+}
+
+// Drop a file from memory
+void free_memory_file(Memory_File * file)
+{
+	free(file->data);
+	file->data = NULL;
+	file->size = 0;
+	file->used = 0;
+
+	return;
+}
+
+// fopen for the compiler's files ("r", "w" and their "b" forms)
+// Returns NULL when a file to read doesn't exist
+FILE * calc_fopen(const char * name, const char * mode)
+{
+	if(!memory_files)
+	{
+		return fopen(name, mode);
+	}
+
+	if(mode[0] == 'r')
+	{
+		static char empty[1];	// fmemopen needs a buffer even for an empty file
+
+		Memory_File * file = find_memory_file(name, 0);
+		if(file == NULL)
+		{
+			return NULL;
+		}
+
+		return fmemopen(file->data != NULL ? file->data : empty, file->size, "r");
+	}
+
+	Memory_File * file = find_memory_file(name, 1);
+	free(file->data);
+	file->data = NULL;
+	file->size = 0;
+
+	return open_memstream(&file->data, &file->size);
+}
+
+// remove for the compiler's files
+int calc_remove(const char * name)
+{
+	if(!memory_files)
+	{
+		return remove(name);
+	}
+
+	Memory_File * file = find_memory_file(name, 0);
+	if(file == NULL)
+	{
+		return -1;
+	}
+
+	free_memory_file(file);
+
+	return 0;
+}
+
+// rename for the compiler's files
+int calc_rename(const char * old_name, const char * new_name)
+{
+	if(!memory_files)
+	{
+		return rename(old_name, new_name);
+	}
+
+	Memory_File * file = find_memory_file(old_name, 0);
+	if(file == NULL || strlen(new_name) > MAX_MEM_FILE_NAME_LEN)
+	{
+		return -1;
+	}
+
+	Memory_File * replaced = find_memory_file(new_name, 0);
+	if(replaced != NULL)
+	{
+		free_memory_file(replaced);
+	}
+
+	strcpy(file->name, new_name);
+
+	return 0;
+}
+
+// Look at the idx'th slot of the files in memory
+// Returns 0 past the last slot; name is NULL for an unused slot
+int get_memory_file(int idx, char ** name, char ** data, size_t * size)
+{
+	if(idx >= MAX_MEM_FILES)
+	{
+		return 0;
+	}
+
+	if(file_table[idx].used)
+	{
+		*name = file_table[idx].name;
+		*data = file_table[idx].data;
+		*size = file_table[idx].size;
+	}
+	else
+	{
+		*name = NULL;
+	}
+
+	return 1;
+}
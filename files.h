@@ -0,0 +1,10 @@
+#include <stdio.h>
+
+#define MAX_MEM_FILES			16		// Max number of files kept in memory at once
+#define MAX_MEM_FILE_NAME_LEN	64
+
+void use_memory_files();
+FILE * calc_fopen(const char * name, const char * mode);
+int calc_remove(const char * name);
+int calc_rename(const char * old_name, const char * new_name);
+int get_memory_file(int idx, char ** name, char ** data, size_t * size);
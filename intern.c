@@ -0,0 +1,160 @@
+#include "intern.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// String interning for the front end
+// Every distinct name is copied once into a bump allocated arena and the same
+// pointer is handed back every time it appears again, so scanning and parsing
+// don't need a heap allocation per token and names never need to be freed
+
+typedef struct arena_chunk
+{
+	struct arena_chunk * next;
+	int size;								// Usable bytes in data
+	int used;								// Bytes handed out so far
+	char data[];
+} Arena_Chunk;
+
+Arena_Chunk * arena_head = NULL;			// Chunk currently being bumped from
+
+char ** intern_table = NULL;				// Open addressing hash table of interned strings
+int intern_capacity = 0;
+int intern_count = 0;
+
+// Hand out len bytes from the arena, starting a new chunk when the current one is full
+char * arena_alloc(int len)
+{
+	if(arena_head == NULL || arena_head->used + len > arena_head->size)
+	{
+		int size = len > ARENA_CHUNK_SIZE ? len : ARENA_CHUNK_SIZE;
+		Arena_Chunk * chunk = malloc(sizeof(Arena_Chunk) + size);
+		if(chunk == NULL)
+		{
+			printf("Couldn't allocate string arena chunk\n");
+			exit(1);
+		}
+
+		chunk->next = arena_head;
+		chunk->size = size;
+		chunk->used = 0;
+		arena_head = chunk;
+	}
+
+	char * ptr = arena_head->data + arena_head->used;
+	arena_head->used += len;
+
+	return ptr;
+}
+
+// Hash a string (FNV-1a), optionally folding it to lower case
+unsigned int hash_string(const char * str, int len, int fold_case)
+{
+	unsigned int hash = 2166136261u;
+	int i;
+	for(i = 0; i < len; i++)
+	{
+		unsigned char c = str[i];
+		hash ^= fold_case ? tolower(c) : c;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+// Compare an interned string to a (possibly case folded) token
+int intern_matches(const char * interned, const char * str, int len, int fold_case)
+{
+	int i;
+	for(i = 0; i < len; i++)
+	{
+		char c = fold_case ? tolower((unsigned char) str[i]) : str[i];
+		if(interned[i] != c)
+		{
+			return 0;
+		}
+	}
+
+	return interned[len] == '\0';
+}
+
+// Double the hash table size and put every interned string back in
+void grow_intern_table()
+{
+	int old_capacity = intern_capacity;
+	char ** old_table = intern_table;
+
+	intern_capacity = old_capacity == 0 ? INTERN_TABLE_START : old_capacity * 2;
+	intern_table = calloc(intern_capacity, sizeof(char *));
+	if(intern_table == NULL)
+	{
+		printf("Couldn't allocate intern table\n");
+		exit(1);
+	}
+
+	int i;
+	for(i = 0; i < old_capacity; i++)
+	{
+		if(old_table[i] != NULL)
+		{
+			unsigned int slot = hash_string(old_table[i], strlen(old_table[i]), 0) & (intern_capacity - 1);
+			while(intern_table[slot] != NULL)
+			{
+				slot = (slot + 1) & (intern_capacity - 1);
+			}
+			intern_table[slot] = old_table[i];
+		}
+	}
+
+	free(old_table);
+
+	return;
+}
+
+// Helper function for intern and intern_lower
+// Return the interned copy of str, creating it the first time str is seen
+char * intern_string(const char * str, int len, int fold_case)
+{
+	if((intern_count + 1) * 2 > intern_capacity)	// Keep table at most half full
+	{
+		grow_intern_table();
+	}
+
+	unsigned int slot = hash_string(str, len, fold_case) & (intern_capacity - 1);
+	while(intern_table[slot] != NULL)
+	{
+		if(intern_matches(intern_table[slot], str, len, fold_case))
+		{
+			return intern_table[slot];
+		}
+
+		slot = (slot + 1) & (intern_capacity - 1);	// Linear probing
+	}
+
+	char * copy = arena_alloc(len + 1);
+	int i;
+	for(i = 0; i < len; i++)
+	{
+		copy[i] = fold_case ? tolower((unsigned char) str[i]) : str[i];
+	}
+	copy[len] = '\0';
+
+	intern_table[slot] = copy;
+	intern_count++;
+
+	return copy;
+}
+
+// Intern the first len characters of str as they are
+char * intern(const char * str, int len)
+{
+	return intern_string(str, len, 0);
+}
+
+// Intern the first len characters of str folded to lower case
+// (variable names are case insensitive)
+char * intern_lower(const char * str, int len)
+{
+	return intern_string(str, len, 1);
+}
@@ -0,0 +1,5 @@
+#define ARENA_CHUNK_SIZE		65536	// Bytes per string arena chunk
+#define INTERN_TABLE_START		1024	// Initial number of slots in intern hash table (power of 2)
+
+char * intern(const char * str, int len);
+char * intern_lower(const char * str, int len);
@@ -0,0 +1,427 @@
+#include "files.h"
+#include "peephole.h"
+#include "tac.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Peephole optimizer for the register allocated TAC
+// Slides a window of PEEPHOLE_WINDOW lines over the TAC and applies the
+// patterns below to the first line in the window, looking ahead inside it.
+// Whole passes over the file are repeated until no pattern applies anymore.
+// Lookahead stops at if/else lines: code after them may be reached from
+// another path, so every value is treated as still needed there. The one
+// exception is merge_if_copies, which looks at a whole if/else when it fits
+// in the window.
+// At the end of the program registers and temps are dead, user variables
+// are not (they're printed out).
+
+Tac_Line window[PEEPHOLE_WINDOW];	// Lines currently being looked at
+int window_count = 0;				// Number of lines in window
+int window_at_eof = 0;				// Set when the last line of input is in the window
+
+// Number of times a line reads name
+int tac_reads(Tac_Line * line, char * name)
+{
+	int reads = 0;
+	int i;
+	for(i = 0; i < line->num_srcs; i++)
+	{
+		if(strcmp(line->srcs[i], name) == 0)
+		{
+			reads++;
+		}
+	}
+
+	return reads;
+}
+
+// Does the line assign a value to name
+int tac_writes(Tac_Line * line, char * name)
+{
+	return line->kind == TAC_ASSIGN && strcmp(line->dest, name) == 0;
+}
+
+// Is the line a plain copy "a = b;"
+int is_copy(Tac_Line * line)
+{
+	return line->kind == TAC_ASSIGN && line->op[0] == '\0';
+}
+
+// Registers are named _r1, _r2, ...
+int is_register(char * name)
+{
+	return name[0] == '_' && name[1] == 'r';
+}
+
+// Constants start with a digit
+int is_constant(char * name)
+{
+	return name[0] >= '0' && name[0] <= '9';
+}
+
+// Is name's value still needed once the end of the window is reached
+// Registers and temps die at the end of the program; user variables are printed
+int live_after_window(char * name)
+{
+	return !window_at_eof || !(is_register(name) || name[0] == '_');
+}
+
+// Fill up the window from the input file
+void fill_window(FILE * input_file)
+{
+	while(window_count < PEEPHOLE_WINDOW && !window_at_eof)
+	{
+		if(fgets(window[window_count].text, TAC_LINE_LEN, input_file) == NULL)
+		{
+			window_at_eof = 1;
+		}
+		else
+		{
+			parse_tac_line(&window[window_count]);
+			window_count++;
+		}
+	}
+
+	return;
+}
+
+// Remove a line from the window
+void delete_window_line(int idx)
+{
+	int i;
+	for(i = idx; i < window_count - 1; i++)
+	{
+		window[i] = window[i + 1];
+	}
+
+	window_count--;
+
+	return;
+}
+
+// Add a line to the window at idx (window must have room)
+void insert_window_line(int idx, Tac_Line * line)
+{
+	int i;
+	for(i = window_count; i > idx; i--)
+	{
+		window[i] = window[i - 1];
+	}
+
+	window[idx] = *line;
+	window_count++;
+
+	return;
+}
+
+// Pattern: "a = a;" does nothing
+int remove_self_copy()
+{
+	if(is_copy(&window[0]) && strcmp(window[0].dest, window[0].srcs[0]) == 0)
+	{
+		delete_window_line(0);
+		return 1;
+	}
+
+	return 0;
+}
+
+// Pattern: after "a = b;" both hold the same value until one of them is written,
+// so a later "a = b;" (duplicate spill/load) or "b = a;" (reload right after a
+// spill, spill right after a load) is redundant
+int remove_redundant_copy()
+{
+	if(!is_copy(&window[0]) || is_constant(window[0].srcs[0]))
+	{
+		return 0;
+	}
+
+	char * a = window[0].dest;
+	char * b = window[0].srcs[0];
+
+	int i;
+	for(i = 1; i < window_count && window[i].kind == TAC_ASSIGN; i++)
+	{
+		if(is_copy(&window[i])
+		&& ((strcmp(window[i].dest, a) == 0 && strcmp(window[i].srcs[0], b) == 0)
+		|| (strcmp(window[i].dest, b) == 0 && strcmp(window[i].srcs[0], a) == 0)))
+		{
+			delete_window_line(i);
+			return 1;
+		}
+
+		if(tac_writes(&window[i], a) || tac_writes(&window[i], b))
+		{
+			break;
+		}
+	}
+
+	return 0;
+}
+
+// Pattern: value written to a variable/register that is written again before
+// it's ever read is dead (includes stores to temps/registers at the end of the program)
+int remove_dead_store()
+{
+	if(window[0].kind != TAC_ASSIGN)
+	{
+		return 0;
+	}
+
+	char * dest = window[0].dest;
+
+	int i;
+	for(i = 1; i < window_count; i++)
+	{
+		if(window[i].kind != TAC_ASSIGN || tac_reads(&window[i], dest))
+		{
+			return 0;
+		}
+
+		if(tac_writes(&window[i], dest))
+		{
+			break;
+		}
+	}
+
+	if(i == window_count && live_after_window(dest))
+	{
+		return 0;
+	}
+
+	delete_window_line(0);
+
+	return 1;
+}
+
+// Pattern: "_rN = b;" followed by uses of _rN before _rN is written again;
+// use b directly in those lines and remove the move
+// Folding a variable from memory into more than one use would add memory reads, so it's skipped
+int fold_move()
+{
+	if(!is_copy(&window[0]) || !is_register(window[0].dest))
+	{
+		return 0;
+	}
+
+	char * reg = window[0].dest;
+	char * src = window[0].srcs[0];
+
+	int num_reads = 0;
+	int last = -1;		// Last line reading the register before it dies
+	int i;
+	for(i = 1; i < window_count; i++)
+	{
+		if(window[i].kind != TAC_ASSIGN)
+		{
+			return 0;	// Register may be read on another path
+		}
+
+		num_reads += tac_reads(&window[i], reg);
+
+		if(tac_writes(&window[i], reg))
+		{
+			last = i;
+			break;
+		}
+		if(tac_writes(&window[i], src))	// Source changes while register is still live
+		{
+			return 0;
+		}
+	}
+
+	if(last == -1)
+	{
+		if(live_after_window(reg))
+		{
+			return 0;
+		}
+		last = window_count - 1;
+	}
+
+	if(num_reads > 1 && !is_register(src) && !is_constant(src))
+	{
+		return 0;
+	}
+
+	char src_name[MAX_USR_VAR_NAME_LEN + 1];
+	strcpy(src_name, src);
+
+	int j;
+	for(i = 1; i <= last; i++)
+	{
+		for(j = 0; j < window[i].num_srcs; j++)
+		{
+			if(strcmp(window[i].srcs[j], reg) == 0)
+			{
+				strcpy(window[i].srcs[j], src_name);
+			}
+		}
+		write_tac_line(&window[i]);
+	}
+
+	delete_window_line(0);
+
+	return 1;
+}
+
+// Can the copy at idx move to the start (dir -1) or the end (dir 1) of the arm
+// made of lines first to last: the lines it moves past don't use its destination
+// or change its source
+int can_move_in_arm(int idx, int first, int last, int dir)
+{
+	Tac_Line * line = &window[idx];
+
+	int i;
+	for(i = idx + dir; i >= first && i <= last; i += dir)
+	{
+		if(tac_reads(&window[i], line->dest) || tac_writes(&window[i], line->dest)
+		|| tac_writes(&window[i], line->srcs[0]))
+		{
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+// Pattern: the same copy (usually a spill) in both arms of an if/else is done
+// once, before the if when both copies can move to the start of their arm (and
+// the condition doesn't read its destination), otherwise after the closing }
+// when both can move to the end of their arm
+// Only applies when the whole if/else, without nested ifs, is in the window
+int merge_if_copies()
+{
+	if(window[0].kind != TAC_IF)
+	{
+		return 0;
+	}
+
+	int else_idx = -1;
+	int end_idx = -1;
+	int i, j;
+	for(i = 1; i < window_count && end_idx == -1; i++)
+	{
+		if(window[i].kind == TAC_IF)
+		{
+			return 0;
+		}
+		else if(window[i].kind == TAC_ELSE)
+		{
+			else_idx = i;
+		}
+		else if(window[i].kind == TAC_END_IF)
+		{
+			end_idx = i;
+		}
+	}
+
+	if(else_idx == -1 || end_idx == -1)
+	{
+		return 0;
+	}
+
+	for(i = else_idx + 1; i < end_idx; i++)
+	{
+		if(!is_copy(&window[i]))
+		{
+			continue;
+		}
+
+		for(j = 1; j < else_idx; j++)
+		{
+			if(strcmp(window[j].text, window[i].text) != 0)
+			{
+				continue;
+			}
+
+			Tac_Line copy = window[i];
+
+			if(strcmp(window[0].srcs[0], copy.dest) != 0
+			&& can_move_in_arm(j, 1, else_idx - 1, -1) && can_move_in_arm(i, else_idx + 1, end_idx - 1, -1))
+			{
+				delete_window_line(i);
+				delete_window_line(j);
+				insert_window_line(0, &copy);
+				return 1;
+			}
+
+			if(can_move_in_arm(j, 1, else_idx - 1, 1) && can_move_in_arm(i, else_idx + 1, end_idx - 1, 1))
+			{
+				delete_window_line(i);
+				delete_window_line(j);
+				insert_window_line(end_idx - 1, &copy);	// Right after the closing } (two lines above it are gone)
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+// One pass of the peephole optimizer over the whole file
+// Returns the number of patterns applied
+int peephole_pass(char * input_reg_tac, char * output_reg_tac)
+{
+	FILE * input_file = calc_fopen(input_reg_tac, "r");
+	if(input_file == NULL)
+	{
+		printf("Unable to open for reading %s for peephole optimization\n", input_reg_tac);
+		exit(1);
+	}
+
+	FILE * output_file = calc_fopen(output_reg_tac, "w");
+	if(output_file == NULL)
+	{
+		printf("Unable to create for writing %s for peephole optimization\n", output_reg_tac);
+		exit(1);
+	}
+
+	int changes = 0;
+	window_count = 0;
+	window_at_eof = 0;
+
+	fill_window(input_file);
+	while(window_count > 0)
+	{
+		if(remove_self_copy() || remove_redundant_copy() || remove_dead_store() || fold_move() || merge_if_copies())
+		{
+			changes++;		// Window changed, try the patterns again on the same spot
+		}
+		else
+		{
+			fprintf(output_file, "%s", window[0].text);
+			delete_window_line(0);
+		}
+
+		fill_window(input_file);
+	}
+
+	fclose(input_file);
+	fclose(output_file);
+
+	return changes;
+}
+
+// Run peephole passes over the register TAC until none of the patterns apply
+void peephole_optimize(char * input_reg_tac, char * output_reg_tac)
+{
+	char pass_reg_tac[] = "Output/peephole-pass.txt";	// Input of the passes after the first
+
+	int changes = peephole_pass(input_reg_tac, output_reg_tac);
+	while(changes > 0)
+	{
+		if(calc_rename(output_reg_tac, pass_reg_tac) != 0)
+		{
+			printf("Unable to rename %s for peephole optimization\n", output_reg_tac);
+			exit(1);
+		}
+
+		changes = peephole_pass(pass_reg_tac, output_reg_tac);
+	}
+
+	calc_remove(pass_reg_tac);
+
+	return;
+}
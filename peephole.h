@@ -0,0 +1,3 @@
+#define PEEPHOLE_WINDOW			16		// Number of register TAC lines the peephole optimizer looks at once
+
+void peephole_optimize(char * input_reg_tac, char * output_reg_tac);
@@ -0,0 +1,68 @@
+#include "protocol.h"
+#include <unistd.h>
+
+// Reading and writing the compile server's framed messages
+// Header lines are short, so they're read a byte at a time and nothing past
+// the newline is consumed; the contents after them are read with read_all
+
+// Write all of buf, retrying short writes
+// Returns 0 if the other end went away
+int write_all(int fd, const char * buf, size_t len)
+{
+	while(len > 0)
+	{
+		ssize_t written = write(fd, buf, len);
+		if(written <= 0)
+		{
+			return 0;
+		}
+
+		buf += written;
+		len -= written;
+	}
+
+	return 1;
+}
+
+// Read exactly len bytes
+// Returns 0 on end of input or error
+int read_all(int fd, char * buf, size_t len)
+{
+	while(len > 0)
+	{
+		ssize_t got = read(fd, buf, len);
+		if(got <= 0)
+		{
+			return 0;
+		}
+
+		buf += got;
+		len -= got;
+	}
+
+	return 1;
+}
+
+// Read a header line, without its newline
+// Returns the line's length, or -1 on end of input, error or a line that's too long
+int read_line(int fd, char * line, int max_len)
+{
+	int len = 0;
+	while(len < max_len - 1)
+	{
+		if(read(fd, &line[len], 1) != 1)
+		{
+			return -1;
+		}
+
+		if(line[len] == '\n')
+		{
+			line[len] = '\0';
+			return len;
+		}
+
+		len++;
+	}
+
+	return -1;
+}
@@ -0,0 +1,18 @@
+#include <stddef.h>
+
+// Compile server protocol (see server.c)
+// Request:  COMPILE <program length> [calc option ...]\n<program>
+// Response: FILE <name> <length>\n<contents>		for each output file
+//           LOG <length>\n<everything calc printed>
+//           END <exit status> <latency in microseconds>\n
+
+#define SERVER_SOCKET_PATH		"/tmp/calc-server.sock"	// Socket the client connects to by default
+#define SERVER_INPUT_NAME		"Input/program.txt"		// Name of a request's program (in memory)
+#define SERVER_OUTPUT_DIR		"Output/"				// Every file in a response is directly in here
+#define MAX_FRAME_LINE_LEN		256		// Max length of a request/response header line
+#define MAX_REQUEST_OPTIONS		16		// Max calc options in a request
+#define SERVER_IO_TIMEOUT_SEC	30		// A client connection that stalls this long is dropped
+
+int write_all(int fd, const char * buf, size_t len);
+int read_all(int fd, char * buf, size_t len);
+int read_line(int fd, char * line, int max_len);
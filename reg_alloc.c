@@ -1,3 +1,4 @@
+#include "files.h"
 #include "reg_alloc.h"
 #include <limits.h>
 #include <stdio.h>
@@ -7,19 +8,21 @@
 typedef struct node
 {
 	char var_name[MAX_USR_VAR_NAME_LEN];
+	int var_id;								// Index of the variable the node's live range belongs to
 
 	int assigned_reg;						// Register variable is assigned to
 	int dirty;								// Has the var been written to while stored in a register
 	int loaded;								// Has the variable's current value been loaded into it's register yet
 
 	int profit;								// The profitability of a variable (used in RIG gen)
+	int period_profits[MAX_LIVE_PERIODS];	// Profit counted separately for each liveness period
 	int reg_tag;							// no spill, may spill (used in RIG gen)
 
 	int num_live_periods;					// Number of liveness start/end periods
 	int live_starts[MAX_LIVE_PERIODS];		// Line in TAC where variable starts life
 	int live_ends[MAX_LIVE_PERIODS];		// Last line in TAC where variable is used
 	int num_neighbors;						// Total number of variables this variable interferes with
-	int neighbors[MAX_TOTAL_VARS];
+	int neighbors[MAX_RIG_NODES];
 } Node;
 
 // Assuming only two-deep nested ifs are allowed for this project
@@ -30,22 +33,36 @@ typedef struct if_spills
 	int inside_if_1;
 	int if_1_start_line;
 	int num_spilled1;
-	int vars_spilled1[MAX_TOTAL_VARS];
+	int vars_spilled1[MAX_RIG_NODES];
 
 	int inside_if_2;
 	int if_2_start_line;
 	int num_spilled2;
-	int vars_spilled2[MAX_TOTAL_VARS];
+	int vars_spilled2[MAX_RIG_NODES];
 
 } If_Spills;
 
 If_Spills if_spill_tracker;			// Tracks spills that occur inside if/else statements
 
 int num_nodes = 0;					// Number of notes in RIG
-Node node_graph[MAX_TOTAL_VARS];	// Register interference graph (RIG)
+Node node_graph[MAX_RIG_NODES];	// Register interference graph (RIG)
 
 int stack_ptr = 0;					// points to next open spot at top of stack
-Node node_stack[MAX_TOTAL_VARS];
+Node node_stack[MAX_RIG_NODES];
+
+int num_vars = 0;					// Number of unique variables (before live range splitting)
+int num_tac_lines = 0;				// Number of lines in the frontend TAC
+
+// Liveness events indexed by TAC line, used by the register TAC generation
+// Each line has a list of the nodes whose live range starts/ends on it
+int * live_start_heads = NULL;		// First node in each line's list (-1 if empty)
+int * live_end_heads = NULL;
+int next_live_start[MAX_RIG_NODES];	// Next node in the same line's list
+int next_live_end[MAX_RIG_NODES];
+int active_node[MAX_TOTAL_VARS];	// Node of each variable's most recently started live range
+
+int var_hash_table[VAR_HASH_SIZE];	// Variable name -> var_id (-1 if empty slot)
+int var_first_node[MAX_TOTAL_VARS];	// A node of each variable (used to compare names)
 
 // Given index for a node in node_graph, return variable name of that node
 // Wrapper for code_graph[index].var_name;
@@ -158,8 +175,11 @@ void update_node(char * var_name, int line_num, int assigned)
 		node_graph[num_nodes].reg_tag = -1;
 		node_graph[num_nodes].num_live_periods = 1;
 		node_graph[num_nodes].num_neighbors = 0;
+		node_graph[num_nodes].var_id = num_nodes;
 		memset(node_graph[num_nodes].live_starts, -1, sizeof(int) * MAX_LIVE_PERIODS);
 		memset(node_graph[num_nodes].live_ends, -1, sizeof(int) * MAX_LIVE_PERIODS);
+		memset(node_graph[num_nodes].period_profits, 0, sizeof(int) * MAX_LIVE_PERIODS);
+		node_graph[num_nodes].period_profits[0] = 1;
 
 		if(assigned)	// Variable becomes live on next line if it is being assigned value
 		{
@@ -188,11 +208,13 @@ void update_node(char * var_name, int line_num, int assigned)
 			{
 				node_graph[index].live_starts[last_period] = line_num + 1;
 				node_graph[index].live_ends[last_period] = line_num + 1;
+				node_graph[index].period_profits[last_period]++;
 			}
 			else
 			{
 				node_graph[index].live_starts[last_period + 1] = line_num + 1;
 				node_graph[index].live_ends[last_period + 1] = line_num + 1;
+				node_graph[index].period_profits[last_period + 1]++;
 				node_graph[index].num_live_periods++;
 
 				if(node_graph[index].num_live_periods >= MAX_LIVE_PERIODS)
@@ -219,6 +241,8 @@ void update_node(char * var_name, int line_num, int assigned)
 			{
 				node_graph[index].live_ends[last_period] = line_num;
 			}
+
+			node_graph[index].period_profits[last_period]++;
 		}
 	}
 
@@ -250,7 +274,7 @@ void end_liveness_inside_if_else(int if_else_start, int if_else_end)
 // Initialize the node for each variable
 void initialize_nodes(char* file_name)
 {
-	FILE * tac_code = fopen(file_name, "r");
+	FILE * tac_code = calc_fopen(file_name, "r");
 	if(tac_code == NULL)
 	{
 		printf("Can't open frontend TAC file in register allocation stage\n");
@@ -319,19 +343,75 @@ void initialize_nodes(char* file_name)
 		else	// Normal case (not entering or leaving if/else)
 		{
 			// At most 3 tokens per TAC line
-			update_node(strtok(line, " +-*/!=;"), line_num, 1);	// First token will be variable assignment
-			update_node(strtok(NULL, " +-*/!=;"), line_num, 0);
-			update_node(strtok(NULL, " +-*/!=;"), line_num, 0);	// Will return NULL if no 3rd token
+			char * assigned_var = strtok(line, " +-*/!?=;");		// First token will be variable assignment
+			char * operand1 = strtok(NULL, " +-*/!?=;");
+			char * operand2 = strtok(NULL, " +-*/!?=;");			// Will return NULL if no 3rd token
+
+			// Operands are read before the assignment happens, so they must extend
+			// the current liveness period before the assignment starts a new one
+			update_node(operand1, line_num, 0);
+			update_node(operand2, line_num, 0);
+			update_node(assigned_var, line_num, 1);
 		}
 
 		line_num++;
 	}
 
+	num_tac_lines = line_num - 1;
+	num_vars = num_nodes;
+
 	fclose(tac_code);
 
 	return;
 }
 
+// Live-range splitting
+// Give each liveness period of a variable its own node in the RIG so the
+// variable can be in a register for some periods and spilled for others.
+// Values always go through memory at period boundaries (spill at end if dirty,
+// load at start if read first), so the periods can be colored independently.
+// Periods with a -1 start (liveness ended in an if/else, never used again) are dropped
+void split_live_ranges()
+{
+	int original_num_nodes = num_nodes;
+	int i, j;
+
+	for(i = 0; i < original_num_nodes; i++)
+	{
+		Node * orig = &node_graph[i];
+
+		// Period 0 stays in the original node, later periods get new nodes
+		for(j = 1; j < orig->num_live_periods; j++)
+		{
+			if(orig->live_starts[j] == -1)
+			{
+				continue;
+			}
+
+			if(num_nodes >= MAX_RIG_NODES)
+			{
+				printf("Maximum number of RIG nodes created while splitting %s\n", orig->var_name);
+				exit(1);
+			}
+
+			Node * split = &node_graph[num_nodes];
+			*split = *orig;
+			split->num_live_periods = 1;
+			split->live_starts[0] = orig->live_starts[j];
+			split->live_ends[0] = orig->live_ends[j];
+			split->period_profits[0] = orig->period_profits[j];
+			split->profit = orig->period_profits[j];
+			num_nodes++;
+		}
+
+		// Shrink original node down to its first period
+		orig->num_live_periods = 1;
+		orig->profit = orig->period_profits[0];
+	}
+
+	return;
+}
+
 // Helper function for find_neighbors
 // Determines if two nodes interfere (liveness periods overlap)
 int does_interfere(int node_idx1, int node_idx2)
@@ -474,12 +554,143 @@ void select_register(int node_idx)
 
 ////// START TAC REGISTER GENERATION FUNCTIONS ///////
 
+// Hash a variable name into var_hash_table (djb2)
+unsigned int hash_var_name(char * var_name)
+{
+	unsigned int hash = 5381;
+	int i;
+	for(i = 0; var_name[i] != '\0'; i++)
+	{
+		hash = hash * 33 + var_name[i];
+	}
+
+	return hash & (VAR_HASH_SIZE - 1);
+}
+
+// Find the var_id of a variable name; return -1 if variable not found
+int get_var_id(char * var_name)
+{
+	unsigned int slot = hash_var_name(var_name);
+
+	while(var_hash_table[slot] != -1)
+	{
+		int var_id = var_hash_table[slot];
+		if(strcmp(node_graph[var_first_node[var_id]].var_name, var_name) == 0)
+		{
+			return var_id;
+		}
+
+		slot = (slot + 1) & (VAR_HASH_SIZE - 1);	// Linear probing
+	}
+
+	return -1;
+}
+
+// Put the liveness start/end of every node into its line's list
+// and the variable names into the hash table
+// Lets the register TAC generation only look at the nodes whose state changes on each line
+void index_live_range_events()
+{
+	// Live ranges can end one line past the end (variable assigned on last line)
+	live_start_heads = malloc(sizeof(int) * (num_tac_lines + 2));
+	live_end_heads = malloc(sizeof(int) * (num_tac_lines + 2));
+	if(live_start_heads == NULL || live_end_heads == NULL)
+	{
+		printf("Can't allocate liveness event lists\n");
+		exit(1);
+	}
+
+	memset(live_start_heads, -1, sizeof(int) * (num_tac_lines + 2));
+	memset(live_end_heads, -1, sizeof(int) * (num_tac_lines + 2));
+	memset(var_hash_table, -1, sizeof(int) * VAR_HASH_SIZE);
+	memset(active_node, -1, sizeof(int) * MAX_TOTAL_VARS);
+
+	int i;
+	for(i = num_nodes - 1; i >= 0; i--)		// Backwards so each list is in node order
+	{
+		int start = node_graph[i].live_starts[0];
+		int end = node_graph[i].live_ends[0];
+
+		next_live_start[i] = live_start_heads[start];
+		live_start_heads[start] = i;
+
+		next_live_end[i] = live_end_heads[end];
+		live_end_heads[end] = i;
+
+		var_first_node[node_graph[i].var_id] = i;
+	}
+
+	for(i = 0; i < num_vars; i++)
+	{
+		unsigned int slot = hash_var_name(node_graph[var_first_node[i]].var_name);
+		while(var_hash_table[slot] != -1)
+		{
+			slot = (slot + 1) & (VAR_HASH_SIZE - 1);
+		}
+		var_hash_table[slot] = i;
+	}
+
+	return;
+}
+
+// Free the liveness event lists
+void free_live_range_events()
+{
+	free(live_start_heads);
+	free(live_end_heads);
+	live_start_heads = NULL;
+	live_end_heads = NULL;
+
+	return;
+}
+
+// Make the live ranges starting on line_num the active ones for their variables
+// Must run at the START of EVERY TAC generation loop
+void activate_live_ranges(int line_num)
+{
+	int i;
+	for(i = live_start_heads[line_num]; i != -1; i = next_live_start[i])
+	{
+		active_node[node_graph[i].var_id] = i;
+	}
+
+	return;
+}
+
+// Find the node holding the live range of var_name that is active on line_num
+// An assignment on line_num starts a live range on the next line; a read uses
+// the live range that is currently active. Return -1 if no live range matches
+int get_live_node_index(char * var_name, int line_num, int assigned)
+{
+	int var_id = get_var_id(var_name);
+	if(var_id == -1)
+	{
+		return -1;
+	}
+
+	if(!assigned)
+	{
+		return active_node[var_id];
+	}
+
+	int i;
+	for(i = live_start_heads[line_num + 1]; i != -1; i = next_live_start[i])
+	{
+		if(node_graph[i].var_id == var_id)
+		{
+			return i;
+		}
+	}
+
+	return -1;
+}
+
 // Write the variable to the output TAC file
 // If the variable was assigned a register, switch variable name for register
 // If the variable is in a register and is READ for the first time, load the variable into the register
 void write_out_variable(FILE * output_tac_file, char * output_line, char * var, int assigned, int line_num)
 {
-	int node_idx = get_node_index(var);
+	int node_idx = get_live_node_index(var, line_num, assigned);
 
 	if(node_idx == -1)
 	{
@@ -495,21 +706,12 @@ void write_out_variable(FILE * output_tac_file, char * output_line, char * var,
 		// being assigned a value, need to load variable into register first
 		// This will never need to happen for temporary variables b/c they
 		// will only be assigned a value once and stay in their register then entire time
-		if(!assigned && !node_graph[node_idx].loaded && var[0] != '_')
+		if(!assigned && !node_graph[node_idx].loaded && var[0] != '_'
+		&& node_graph[node_idx].live_starts[0] == line_num)
 		{
-			int num_live_periods = node_graph[node_idx].num_live_periods;
-			int i;
-			for(i = 0; i < num_live_periods; i++)
-			{
-				if(node_graph[node_idx].live_starts[i] == line_num)
-				{
-					fprintf(output_tac_file, "_r%d = %s;\n", reg, var);
-					node_graph[node_idx].loaded = 1;
-					// printf("%s is directly loaded on line %d\n", node_graph[node_idx].var_name, line_num);
-
-					break;
-				}
-			}
+			fprintf(output_tac_file, "_r%d = %s;\n", reg, var);
+			node_graph[node_idx].loaded = 1;
+			// printf("%s is directly loaded on line %d\n", node_graph[node_idx].var_name, line_num);
 		}
 
 		char reg_name[13]; 				// register name can be _r##########
@@ -547,55 +749,37 @@ void write_out_variable(FILE * output_tac_file, char * output_line, char * var,
 void spill_to_variables(FILE * output_tac_file, int line_num)
 {
 	int i;
-	for(i = 0; i < num_nodes; i++)	// Go through each variable and see if it needs to be spilled
+	for(i = live_end_heads[line_num]; i != -1; i = next_live_end[i])	// Only live ranges ending on this line
 	{
 		if(node_graph[i].dirty)
 		{
-			int num_live_periods = node_graph[i].num_live_periods;
-			int do_spill = 0;
-			int j;
-
-			// See if one of the variable's liveness periods ends at current line
-			// j will contain index to the relevant liveness period
-			for(j = 0; j < num_live_periods; j++)
-			{
-				if(node_graph[i].live_ends[j] == line_num)
-				{
-					do_spill = 1;
-					break;
-				}
-			}
-
 			// Spill the register back to the user variable
-			if(do_spill)
-			{
-				// printf("Spilling: %s = _r%d;\n", node_graph[i].var_name, node_graph[i].assigned_reg);
+			// printf("Spilling: %s = _r%d;\n", node_graph[i].var_name, node_graph[i].assigned_reg);
 
-				fprintf(output_tac_file, "%s = _r%d;\n", node_graph[i].var_name, node_graph[i].assigned_reg);
-				node_graph[i].dirty = 0;	// Reset dirty value
+			fprintf(output_tac_file, "%s = _r%d;\n", node_graph[i].var_name, node_graph[i].assigned_reg);
+			node_graph[i].dirty = 0;	// Reset dirty value
 
-				int current_live_start = node_graph[i].live_starts[j];	// Get the starting point of the current live period
+			int current_live_start = node_graph[i].live_starts[0];	// Get the starting point of the current live period
 
-				// Handle cases where variable declared before if-else is spilled inside an if/else statement
-				// Case where variable defined before start of inner if-else
-				if(if_spill_tracker.inside_if_2 && (current_live_start <= if_spill_tracker.if_2_start_line))
-				{
-					if_spill_tracker.vars_spilled2[if_spill_tracker.num_spilled2] = i;
-					if_spill_tracker.num_spilled2++;
-
-					// If var was defined even before the start of outer if statement, it ALSO needs to be spilled
-					// in the outer if statement incase the inner if statement is not run
-					if((current_live_start <= if_spill_tracker.if_1_start_line))
-					{
-						if_spill_tracker.vars_spilled1[if_spill_tracker.num_spilled1] = i;
-						if_spill_tracker.num_spilled1++;
-					}
-				}	// Case where variable defined before start of outer if-else
-				else if(if_spill_tracker.inside_if_1 && (current_live_start <= if_spill_tracker.if_1_start_line))
+			// Handle cases where variable declared before if-else is spilled inside an if/else statement
+			// Case where variable defined before start of inner if-else
+			if(if_spill_tracker.inside_if_2 && (current_live_start <= if_spill_tracker.if_2_start_line))
+			{
+				if_spill_tracker.vars_spilled2[if_spill_tracker.num_spilled2] = i;
+				if_spill_tracker.num_spilled2++;
+
+				// If var was defined even before the start of outer if statement, it ALSO needs to be spilled
+				// in the outer if statement incase the inner if statement is not run
+				if((current_live_start <= if_spill_tracker.if_1_start_line))
 				{
 					if_spill_tracker.vars_spilled1[if_spill_tracker.num_spilled1] = i;
 					if_spill_tracker.num_spilled1++;
 				}
+			}	// Case where variable defined before start of outer if-else
+			else if(if_spill_tracker.inside_if_1 && (current_live_start <= if_spill_tracker.if_1_start_line))
+			{
+				if_spill_tracker.vars_spilled1[if_spill_tracker.num_spilled1] = i;
+				if_spill_tracker.num_spilled1++;
 			}
 		}
 	}
@@ -643,21 +827,12 @@ void after_if_spill(FILE * output_tac_file, int if_num)
 void mark_unloaded(int line_num)
 {
 	int i;
-	for(i = 0; i < num_nodes; i++)
+	for(i = live_end_heads[line_num]; i != -1; i = next_live_end[i])	// Only live ranges ending on this line
 	{
 		if(node_graph[i].var_name[0] != '_')
 		{
-			int num_live_periods = node_graph[i].num_live_periods;
-			int j;
-			for(j = 0; j < num_live_periods; j++)
-			{
-				if(node_graph[i].live_ends[j] == line_num)
-				{
-					node_graph[i].loaded = 0;
-					// printf("%s is unloaded on line %d\n", node_graph[i].var_name, line_num);
-					break;
-				}
-			}
+			node_graph[i].loaded = 0;
+			// printf("%s is unloaded on line %d\n", node_graph[i].var_name, line_num);
 		}
 	}
 }
@@ -678,22 +853,16 @@ void init_if_spill_tracker()
 
 // Create the TAC with register assignment
 // Reads in frontend TAC and replaces variables with assigned registers
-// Also inserts spilling
-void gen_reg_tac(char * input_tac_file_name, char * output_tac_file_name)
+// Also inserts spilling; output is written to the end of output_tac_file
+void gen_reg_tac(char * input_tac_file_name, FILE * output_tac_file)
 {
-	FILE * input_tac_file = fopen(input_tac_file_name,"r");
-	FILE * output_tac_file = fopen(output_tac_file_name,"w");
+	FILE * input_tac_file = calc_fopen(input_tac_file_name,"r");
 
 	if(input_tac_file == NULL)
 	{
 		printf("Can't open input TAC file (%s) in register allocation stage\n", input_tac_file_name);
 		exit(1);
 	}
-	else if(output_tac_file == NULL)
-	{
-		printf("Can't create output TAC file (%s) in register allocation stage\n", output_tac_file_name);
-		exit(1);
-	}
 
 	// Read in front end TAC and insert registers
 	char input_line[MAX_USR_VAR_NAME_LEN * 4];		// Frontend TAC line read in
@@ -704,9 +873,12 @@ void gen_reg_tac(char * input_tac_file_name, char * output_tac_file_name)
 	// Initial tracker for spills inside ifs
 	init_if_spill_tracker();
 
+	index_live_range_events();
+
 	while(fgets(input_line, MAX_USR_VAR_NAME_LEN * 4, input_tac_file) != NULL)
 	{
 		strcpy(output_line, ""); 							// Clear output line for next use
+		activate_live_ranges(line_num);
 		spill_to_variables(output_tac_file, line_num);		// Write back register values to vars on their last use
 
 		// Handle if/else statements
@@ -795,7 +967,7 @@ void gen_reg_tac(char * input_tac_file_name, char * output_tac_file_name)
 					write_out_variable(output_tac_file, output_line, token + 1, 0, line_num);	// Don't include ! in variable name
 				}
 			}
-			else if(token[0] < '0')	// Write out operators: +, -, *, /, **
+			else if(token[0] < '0' || token[0] == '?')	// Write out operators: +, -, *, /, **, ?
 			{
 				strcat(output_line, " ");
 				strcat(output_line, token);
@@ -825,75 +997,156 @@ void gen_reg_tac(char * input_tac_file_name, char * output_tac_file_name)
 	// Need to spill registers of variables that die after the last TAC file line
 	spill_to_variables(output_tac_file, line_num);
 
+	free_live_range_events();
+
 	fclose(input_tac_file);
-	fclose(output_tac_file);
 
 	return;
 }
 
-// Goes through the tac file with register assignments, looks for unneeded
-// self assignment lines like "_r1 = _r1;" and removes them
-// This is a simple optimization that generates a new file
-void remove_self_assignment(char * input_reg_tac, char * output_reg_tac)
+////// END TAC REGISTER GENERATION FUNCTIONS ///////
+
+////// START INTERVAL ALLOCATION FUNCTIONS ///////
+
+// Helper function for sort_nodes_by_live_start (used with qsort)
+int compare_live_starts(const void * a, const void * b)
 {
-	FILE * input_file = fopen(input_reg_tac, "r");
-	if(input_file == NULL)
-	{
-		printf("Unable to open for reading %s for self assignment removal\n", input_reg_tac);
-		return;
-	}
+	const Node * node_a = (const Node *) a;
+	const Node * node_b = (const Node *) b;
 
-	FILE * output_file = fopen(output_reg_tac, "w");
-	if(output_file == NULL)
-	{
-		printf("Unable to create for writing %s for self assignment removal\n", output_reg_tac);
-		return;
-	}
+	return node_a->live_starts[0] - node_b->live_starts[0];
+}
+
+// Order the RIG by the line each live range starts on
+// After live range splitting every node has a single live period, an interval of
+// TAC lines (it may start at a definition, at a read of an undefined variable or
+// across an if/else join), so the RIG is an interval graph and this order is a
+// perfect elimination order of it
+// Must be called before find_all_neighbors since neighbor lists hold node indices
+void sort_nodes_by_live_start()
+{
+	qsort(node_graph, num_nodes, sizeof(Node), compare_live_starts);
 
-	char input_line[MAX_USR_VAR_NAME_LEN * 4];
-	while(fgets(input_line, MAX_USR_VAR_NAME_LEN * 4, input_file) != NULL)
+	return;
+}
+
+// Color the live ranges optimally for an interval interference graph
+// Nodes are visited in perfect elimination order; every already colored neighbor's
+// interval overlaps the node's start, so they form a clique with the node
+// If that clique needs more than NUM_REG registers, the live range in it that ends
+// furthest away is spilled (this spills the fewest live ranges possible)
+// Returns the number of registers an allocation with no spills would need
+int interval_color_registers()
+{
+	int max_regs_needed = 0;
+	int i, j;
+
+	for(i = 0; i < num_nodes; i++)
 	{
-		char temp[MAX_USR_VAR_NAME_LEN * 4];
-		char * token1;
-		char * token2;
-		char * token3;
+		int clique_size = 1;	// Node plus its already colored neighbors
+		int taken_regs[NUM_REG];
+		memset(taken_regs, 0, sizeof(int) * NUM_REG);
 
-		strcpy(temp, input_line);	// Copy to temp so input_line isn't edited by strtok
+		for(j = 0; j < node_graph[i].num_neighbors; j++)
+		{
+			int neighbor_idx = node_graph[i].neighbors[j];
+
+			if(neighbor_idx < i)	// Neighbor comes earlier in the elimination order
+			{
+				clique_size++;
 
-		token1 = strtok(temp, " =;\n");		// token1 must match token2
-		token2 = strtok(NULL, " =;\n");
-		token3 = strtok(NULL, " =;\n");		// token 3 must be empty (self assigns only have 2 variables)
+				if(node_graph[neighbor_idx].assigned_reg != -1)
+				{
+					taken_regs[node_graph[neighbor_idx].assigned_reg - 1] = 1;
+				}
+			}
+		}
 
-		// printf("token1=%s, token2=%s, token3=%s\n", token1, token2, token3);
+		if(clique_size > max_regs_needed)
+		{
+			max_regs_needed = clique_size;
+		}
 
-		if(token1 != NULL && token2 != NULL)	// Can't send strcmp a NULL string
+		for(j = 0; j < NUM_REG; j++)
 		{
-			if((strcmp(token1, token2) == 0) && (token3 == NULL))
+			if(taken_regs[j] == 0)
 			{
-				// printf("REMOVED: %s", input_line);
-				continue;	// Don't write self assignment line to output file
+				node_graph[i].assigned_reg = j + 1;		// Register are r1, r2, ...
+				break;
 			}
 		}
 
-		fprintf(output_file, "%s", input_line); // Copy input line to output file without editing it
+		if(node_graph[i].assigned_reg != -1)
+		{
+			continue;
+		}
+
+		// All registers are taken; find the colored neighbor that lives the longest
+		// Lower profit breaks ties so the less used live range is spilled
+		int victim_idx = i;
+		for(j = 0; j < node_graph[i].num_neighbors; j++)
+		{
+			int neighbor_idx = node_graph[i].neighbors[j];
+
+			if(neighbor_idx < i && node_graph[neighbor_idx].assigned_reg != -1)
+			{
+				int neighbor_end = node_graph[neighbor_idx].live_ends[0];
+				int victim_end = node_graph[victim_idx].live_ends[0];
+
+				if(neighbor_end > victim_end
+				|| (neighbor_end == victim_end && node_graph[neighbor_idx].profit < node_graph[victim_idx].profit))
+				{
+					victim_idx = neighbor_idx;
+				}
+			}
+		}
+
+		// Hand the victim's register over to the current node and spill the victim
+		if(victim_idx != i)
+		{
+			node_graph[i].assigned_reg = node_graph[victim_idx].assigned_reg;
+			node_graph[victim_idx].assigned_reg = -1;
+		}
+	}
+
+	return max_regs_needed;
+}
+
+// Allocate registers by coloring the interval graph of the split live periods
+// Relies only on live range splitting leaving one live period per RIG node, so
+// the interference graph is an interval graph. Values meeting at an if/else join
+// go through the variable's memory location, which both arms spill to, so the
+// join never needs register to register copies
+void interval_allocate()
+{
+	sort_nodes_by_live_start();
+	find_all_neighbors();
+
+	int max_regs_needed = interval_color_registers();
+
+	int num_spilled = 0;
+	int i;
+	for(i = 0; i < num_nodes; i++)
+	{
+		if(node_graph[i].assigned_reg == -1)
+		{
+			num_spilled++;
+		}
 	}
 
-	fclose(input_file);
-	fclose(output_file);
+	printf("Interval allocation: %d registers needed, %d available, %d live ranges spilled\n",
+			max_regs_needed, NUM_REG, num_spilled);
 
 	return;
 }
 
-////// END TAC REGISTER GENERATION FUNCTIONS ///////
+////// END INTERVAL ALLOCATION FUNCTIONS ///////
 
-////// START MAIN LOGIC FUNCTION ///////
+////// START HEURISTIC ALLOCATION FUNCTIONS ///////
 
-// Allocate registers using a RIG and a heuristic "optimistic" algorithm
-// Then write out TAC code with register assignment
-void allocate_registers(char * frontend_tac_file_name, char * reg_tac_file_name)
+// Allocate registers using a heuristic "optimistic" algorithm on the RIG
+void optimistic_allocate()
 {
-	// First two functions create the RIG
-	initialize_nodes(frontend_tac_file_name);
 	find_all_neighbors();
 
 	// print_node_graph();
@@ -957,10 +1210,70 @@ void allocate_registers(char * frontend_tac_file_name, char * reg_tac_file_name)
 		select_register(i);		// Assign registers
 	}
 
+	return;
+}
+
+////// END HEURISTIC ALLOCATION FUNCTIONS ///////
+
+////// START MAIN LOGIC FUNCTIONS ///////
+
+// Build the RIG for the TAC file and assign registers to its live ranges
+// with either the heuristic or the interval allocation mode
+void color_registers(char * frontend_tac_file_name, int alloc_mode)
+{
+	// Start from an empty RIG
+	num_nodes = 0;
+	stack_ptr = 0;
+
+	// Create the RIG nodes, one for each live range
+	initialize_nodes(frontend_tac_file_name);
+	split_live_ranges();
+
+	if(alloc_mode == ALLOC_INTERVAL)
+	{
+		interval_allocate();
+	}
+	else
+	{
+		optimistic_allocate();
+	}
+
+	return;
+}
+
+// Allocate registers for the whole program
+// Then write out TAC code with register assignment
+void allocate_registers(char * frontend_tac_file_name, char * reg_tac_file_name, int alloc_mode)
+{
+	color_registers(frontend_tac_file_name, alloc_mode);
+
 	print_node_graph();
 
+	FILE * reg_tac_file = calc_fopen(reg_tac_file_name, "w");
+	if(reg_tac_file == NULL)
+	{
+		printf("Can't create output TAC file (%s) in register allocation stage\n", reg_tac_file_name);
+		exit(1);
+	}
+
 	// Create unoptimized output TAC with register assignment inserted
-	gen_reg_tac(frontend_tac_file_name, reg_tac_file_name);
+	gen_reg_tac(frontend_tac_file_name, reg_tac_file);
+
+	fclose(reg_tac_file);
+
+	return;
+}
+
+// Allocate registers for one region (window of statements) of the program
+// and add its TAC with register assignment to the end of reg_tac_file
+// Every user variable is in memory at the start and end of a region (live ranges
+// are spilled when they end and loaded when they start), so regions are independent
+// and the RIG only ever holds one region
+void allocate_registers_region(char * region_tac_file_name, FILE * reg_tac_file, int alloc_mode)
+{
+	color_registers(region_tac_file_name, alloc_mode);
+
+	gen_reg_tac(region_tac_file_name, reg_tac_file);
 
 	return;
 }
@@ -1,11 +1,18 @@
+#include <stdio.h>
+
 #define MAX_USR_NUM_VARS 		30		// Max number of unique user variables allowed
 #define MAX_USR_VAR_NAME_LEN 	30 		// How long a user variable name can be (not including \0)
 #define MAX_TOTAL_VARS			128		// Total number of unique variables (user and temp) that can appear
 #define MAX_LIVE_PERIODS 		128		// Max number of distinct periods in which a var can be alive
+#define MAX_RIG_NODES			256		// Max number of nodes in RIG (one per live range after splitting)
+#define VAR_HASH_SIZE			256		// Size of variable name hash table (power of 2, > MAX_TOTAL_VARS)
 #define NUM_REG					4		// Number of registers available ("k" value for graph coloring)
 
 #define NO_SPILL				0
 #define MAY_SPILL				1
 
-void remove_self_assignment(char * input_reg_tac, char * output_reg_tac);
-void allocate_registers(char * frontend_tac_file_name, char * reg_tac_file_name);
+#define ALLOC_HEURISTIC			0		// Optimistic graph coloring on the RIG (default)
+#define ALLOC_INTERVAL			1		// Optimal coloring of the interval graph of split live periods
+
+void allocate_registers(char * frontend_tac_file_name, char * reg_tac_file_name, int alloc_mode);
+void allocate_registers_region(char * region_tac_file_name, FILE * reg_tac_file, int alloc_mode);
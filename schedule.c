@@ -0,0 +1,809 @@
+#include "files.h"
+#include "reg_alloc.h"
+#include "schedule.h"
+#include "tac.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// List scheduling of the frontend TAC, before register allocation
+// Each straight-line block (the lines between if/else markers) is reordered
+// along its dependence DAG so long latency results (**, /, *) aren't used right
+// away when there's independent work to put in between. Ready lines are picked
+// by their latency weighted height in the DAG.
+// Temps hold values that are only used inside their block, so they're treated
+// as values: only their true dependences are kept and they get new names
+// (lowest free temp first) in the final order. User variables, and temps whose
+// value crosses the block's boundaries, keep every dependence and their names.
+// Register pressure guard: once NUM_REG temp values are live, lines that free
+// values are picked first, and if the schedule's estimated spilling is worse than
+// the original order's the block is left as it was.
+// Enabled with calc -sched.
+
+#define MAX_SCHED_TEMPS		(MAX_TOTAL_VARS - MAX_USR_NUM_VARS)	// Temps the allocator still has room for
+
+typedef struct sched_line
+{
+	Tac_Line tac;			// Line as it was read, split into its parts
+
+	int * live_temps;		// If/else marker lines: temps whose value is read at or after the line
+	int num_live_temps;
+
+	int src_defs[2];		// Line in the block that defined each source's value (-1 if defined before the block)
+	int renamed;			// Dest is a temp value that gets a new name
+	int new_temp;			// Number of dest's new temp name
+
+	int * succs;			// Lines that must come after this one, with the delay before they can start
+	int * succ_delays;
+	int num_succs;
+	int succ_cap;
+	int preds_left;			// Lines that must come before this one that aren't scheduled yet
+
+	int num_uses;			// Lines in the block reading the value this line defines (counting each read)
+	int uses_left;
+	int height;				// Latency weighted length of the longest DAG path from this line to the block's end
+	int earliest;			// Earliest cycle the line can start
+} Sched_Line;
+
+typedef struct name_entry
+{
+	char * name;
+	int last_def;			// Line in the block that last assigned the name (-1 if none yet)
+	int keep;				// Name keeps every dependence (user variable or a temp crossing the block boundary)
+	int * readers;			// Lines reading the name since it was last assigned (only tracked when keep is set)
+	int num_readers;
+	int reader_cap;
+	int last_pos;			// Last position in an order that uses the name (for pressure estimates)
+} Name_Entry;
+
+Sched_Line * lines = NULL;		// Whole TAC file
+int num_lines = 0;
+
+Name_Entry * names = NULL;		// Open addressing hash table of the names in the current block
+int names_size = 0;
+
+// Is name a temp var (_t0, _t1, ...)
+int is_temp(char * name)
+{
+	return name[0] == '_' && name[1] == 't';
+}
+
+// Constants aren't names
+int is_name(char * name)
+{
+	return !(name[0] >= '0' && name[0] <= '9');
+}
+
+// Read the whole TAC file into lines
+void read_sched_lines(char * input_tac_file_name)
+{
+	FILE * input_file = calc_fopen(input_tac_file_name, "r");
+	if(input_file == NULL)
+	{
+		printf("Unable to open for reading %s for scheduling\n", input_tac_file_name);
+		exit(1);
+	}
+
+	int cap = 0;
+	char buf[TAC_LINE_LEN];
+	while(fgets(buf, TAC_LINE_LEN, input_file) != NULL)
+	{
+		if(num_lines >= cap)
+		{
+			cap = cap == 0 ? 256 : cap * 2;
+			lines = realloc(lines, sizeof(Sched_Line) * cap);
+			if(lines == NULL)
+			{
+				printf("Couldn't allocate lines for scheduling\n");
+				exit(1);
+			}
+		}
+
+		memset(&lines[num_lines], 0, sizeof(Sched_Line));
+		strcpy(lines[num_lines].tac.text, buf);
+		parse_tac_line(&lines[num_lines].tac);
+		num_lines++;
+	}
+
+	fclose(input_file);
+
+	return;
+}
+
+// Find a name in the current block's table, adding it if it's not there
+Name_Entry * find_name(char * name)
+{
+	unsigned int hash = 5381;
+	char * c;
+	for(c = name; *c != '\0'; c++)
+	{
+		hash = hash * 33 + (unsigned char) *c;
+	}
+
+	unsigned int idx = hash & (names_size - 1);
+	while(names[idx].name != NULL && strcmp(names[idx].name, name) != 0)
+	{
+		idx = (idx + 1) & (names_size - 1);
+	}
+
+	if(names[idx].name == NULL)
+	{
+		names[idx].name = name;
+		names[idx].last_def = -1;
+		names[idx].keep = !is_temp(name);
+	}
+
+	return &names[idx];
+}
+
+// Add a dependence: line to must start at least delay cycles after line from
+void add_dependence(int from, int to, int delay)
+{
+	Sched_Line * line = &lines[from];
+	if(line->num_succs >= line->succ_cap)
+	{
+		line->succ_cap = line->succ_cap == 0 ? 4 : line->succ_cap * 2;
+		line->succs = realloc(line->succs, sizeof(int) * line->succ_cap);
+		line->succ_delays = realloc(line->succ_delays, sizeof(int) * line->succ_cap);
+		if(line->succs == NULL || line->succ_delays == NULL)
+		{
+			printf("Couldn't allocate dependences for scheduling\n");
+			exit(1);
+		}
+	}
+
+	line->succs[line->num_succs] = to;
+	line->succ_delays[line->num_succs] = delay;
+	line->num_succs++;
+	lines[to].preds_left++;
+
+	return;
+}
+
+// Remember a line reading a name that keeps its dependences
+void add_reader(Name_Entry * entry, int line_num)
+{
+	if(entry->num_readers >= entry->reader_cap)
+	{
+		entry->reader_cap = entry->reader_cap == 0 ? 4 : entry->reader_cap * 2;
+		entry->readers = realloc(entry->readers, sizeof(int) * entry->reader_cap);
+		if(entry->readers == NULL)
+		{
+			printf("Couldn't allocate readers for scheduling\n");
+			exit(1);
+		}
+	}
+
+	entry->readers[entry->num_readers] = line_num;
+	entry->num_readers++;
+
+	return;
+}
+
+// Cycles until a line's result can be used
+int line_latency(Sched_Line * line)
+{
+	if(strcmp(line->tac.op, "**") == 0)
+	{
+		return LATENCY_POW;
+	}
+	if(strcmp(line->tac.op, "/") == 0)
+	{
+		return LATENCY_DIV;
+	}
+	if(strcmp(line->tac.op, "*") == 0)
+	{
+		return LATENCY_MUL;
+	}
+
+	return LATENCY_ALU;
+}
+
+// Find the temps that are live at each block boundary, in one backward pass over the file
+// A temp is live if it's read before it's assigned again, looking ahead in the
+// order the lines are written (a line's reads come before its own assignment)
+void find_live_temps()
+{
+	int max_temp = 0;
+	int i, j;
+	for(i = 0; i < num_lines; i++)
+	{
+		if(is_temp(lines[i].tac.dest) && atoi(lines[i].tac.dest + 2) + 1 > max_temp)
+		{
+			max_temp = atoi(lines[i].tac.dest + 2) + 1;
+		}
+		for(j = 0; j < lines[i].tac.num_srcs; j++)
+		{
+			if(is_temp(lines[i].tac.srcs[j]) && atoi(lines[i].tac.srcs[j] + 2) + 1 > max_temp)
+			{
+				max_temp = atoi(lines[i].tac.srcs[j] + 2) + 1;
+			}
+		}
+	}
+
+	char * live = calloc(max_temp + 1, sizeof(char));
+	if(live == NULL)
+	{
+		printf("Couldn't allocate liveness for scheduling\n");
+		exit(1);
+	}
+
+	for(i = num_lines - 1; i >= 0; i--)
+	{
+		Sched_Line * line = &lines[i];
+
+		if(line->tac.kind == TAC_ASSIGN && is_temp(line->tac.dest))
+		{
+			live[atoi(line->tac.dest + 2)] = 0;
+		}
+		for(j = 0; j < line->tac.num_srcs; j++)
+		{
+			if(is_temp(line->tac.srcs[j]))
+			{
+				live[atoi(line->tac.srcs[j] + 2)] = 1;
+			}
+		}
+
+		if(line->tac.kind == TAC_ASSIGN)
+		{
+			continue;
+		}
+
+		int temp;
+		for(temp = 0; temp < max_temp; temp++)
+		{
+			line->num_live_temps += live[temp];
+		}
+		if(line->num_live_temps == 0)
+		{
+			continue;
+		}
+
+		line->live_temps = malloc(sizeof(int) * line->num_live_temps);
+		if(line->live_temps == NULL)
+		{
+			printf("Couldn't allocate liveness for scheduling\n");
+			exit(1);
+		}
+		line->num_live_temps = 0;
+		for(temp = 0; temp < max_temp; temp++)
+		{
+			if(live[temp])
+			{
+				line->live_temps[line->num_live_temps] = temp;
+				line->num_live_temps++;
+			}
+		}
+	}
+
+	free(live);
+
+	return;
+}
+
+// Is a temp's value from the block [start, end) still read after the block
+// Nothing is live after the last line of the file
+int temp_live_out(char * name, int end)
+{
+	if(end >= num_lines)
+	{
+		return 0;
+	}
+
+	int temp = atoi(name + 2);
+	int i;
+	for(i = 0; i < lines[end].num_live_temps; i++)
+	{
+		if(lines[end].live_temps[i] == temp)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+// Build the dependence DAG of the block [start, end)
+void build_dependences(int start, int end)
+{
+	// Temps read before they're assigned in the block, or whose last value is
+	// read after it, cross the block boundary and keep their names
+	int i, j;
+	for(i = start; i < end; i++)
+	{
+		for(j = 0; j < lines[i].tac.num_srcs; j++)
+		{
+			if(is_name(lines[i].tac.srcs[j]))
+			{
+				Name_Entry * entry = find_name(lines[i].tac.srcs[j]);
+				if(entry->last_def == -1)
+				{
+					entry->keep = 1;
+				}
+			}
+		}
+
+		Name_Entry * entry = find_name(lines[i].tac.dest);
+		entry->last_def = i;
+	}
+
+	for(i = 0; i < names_size; i++)
+	{
+		if(names[i].name != NULL && !names[i].keep && temp_live_out(names[i].name, end))
+		{
+			names[i].keep = 1;
+		}
+		names[i].last_def = -1;
+	}
+
+	// True dependences for every value, false ones (reads and writes of the
+	// same name in the original order) for names that keep their dependences
+	for(i = start; i < end; i++)
+	{
+		Sched_Line * line = &lines[i];
+
+		for(j = 0; j < line->tac.num_srcs; j++)
+		{
+			line->src_defs[j] = -1;
+			if(!is_name(line->tac.srcs[j]))
+			{
+				continue;
+			}
+
+			Name_Entry * entry = find_name(line->tac.srcs[j]);
+			if(entry->last_def != -1)
+			{
+				add_dependence(entry->last_def, i, line_latency(&lines[entry->last_def]));
+				line->src_defs[j] = entry->last_def;
+				lines[entry->last_def].num_uses++;
+			}
+			if(entry->keep)
+			{
+				add_reader(entry, i);
+			}
+		}
+
+		Name_Entry * entry = find_name(line->tac.dest);
+		if(entry->keep)
+		{
+			for(j = 0; j < entry->num_readers; j++)
+			{
+				if(entry->readers[j] != i)
+				{
+					add_dependence(entry->readers[j], i, 0);
+				}
+			}
+			if(entry->last_def != -1)
+			{
+				add_dependence(entry->last_def, i, 1);
+			}
+			entry->num_readers = 0;
+		}
+		entry->last_def = i;
+		line->renamed = !entry->keep;
+	}
+
+	// Heights, from the end of the block back
+	for(i = end - 1; i >= start; i--)
+	{
+		int max_succ = 0;
+		for(j = 0; j < lines[i].num_succs; j++)
+		{
+			if(lines[lines[i].succs[j]].height > max_succ)
+			{
+				max_succ = lines[lines[i].succs[j]].height;
+			}
+		}
+		lines[i].height = line_latency(&lines[i]) + max_succ;
+	}
+
+	return;
+}
+
+// Change in the number of live temp values if line is scheduled next
+int pressure_change(Sched_Line * line)
+{
+	int change = line->renamed && line->num_uses > 0 ? 1 : 0;
+
+	int j;
+	for(j = 0; j < line->tac.num_srcs; j++)
+	{
+		int def = line->src_defs[j];
+		if(def == -1 || !lines[def].renamed || (j == 1 && def == line->src_defs[0]))
+		{
+			continue;
+		}
+
+		int reads = (line->src_defs[0] == def) + (line->tac.num_srcs == 2 && line->src_defs[1] == def);
+		if(lines[def].uses_left == reads)
+		{
+			change--;
+		}
+	}
+
+	return change;
+}
+
+// Account for a line being scheduled; returns the change in live values
+int consume_line(Sched_Line * line)
+{
+	int change = pressure_change(line);
+
+	int j;
+	for(j = 0; j < line->tac.num_srcs; j++)
+	{
+		if(line->src_defs[j] != -1)
+		{
+			lines[line->src_defs[j]].uses_left--;
+		}
+	}
+
+	return change;
+}
+
+// Estimate of the spilling needed when the block [start, end) runs in the given order
+// Temp values are live from their line to their last use, and the allocator keeps
+// the other names in registers too, from their first use in the block to their last
+// Returns the total over the block's lines of the live values past NUM_REG
+int spill_pressure(int * order, int start, int end)
+{
+	int num_block_lines = end - start;
+	int * name_ends = calloc(num_block_lines + 1, sizeof(int));	// Names whose last use is at each position
+	if(name_ends == NULL)
+	{
+		printf("Couldn't allocate pressure estimate for scheduling\n");
+		exit(1);
+	}
+
+	int i, j;
+	for(i = 0; i < names_size; i++)
+	{
+		names[i].last_pos = -1;
+	}
+	for(i = 0; i < num_block_lines; i++)
+	{
+		Sched_Line * line = &lines[order[i]];
+		for(j = 0; j < line->tac.num_srcs; j++)
+		{
+			if(is_name(line->tac.srcs[j]) && find_name(line->tac.srcs[j])->keep)
+			{
+				find_name(line->tac.srcs[j])->last_pos = i;
+			}
+		}
+		if(!line->renamed)
+		{
+			find_name(line->tac.dest)->last_pos = i;
+		}
+	}
+	for(i = 0; i < names_size; i++)
+	{
+		if(names[i].name != NULL && names[i].last_pos != -1)
+		{
+			name_ends[names[i].last_pos]++;
+			names[i].last_pos = -1;
+		}
+	}
+
+	for(i = start; i < end; i++)
+	{
+		lines[i].uses_left = lines[i].num_uses;
+	}
+
+	int live = 0;
+	int excess = 0;
+	for(i = 0; i < num_block_lines; i++)
+	{
+		Sched_Line * line = &lines[order[i]];
+		for(j = 0; j < line->tac.num_srcs; j++)
+		{
+			if(is_name(line->tac.srcs[j]) && find_name(line->tac.srcs[j])->keep)
+			{
+				Name_Entry * entry = find_name(line->tac.srcs[j]);
+				if(entry->last_pos == -1)
+				{
+					entry->last_pos = i;
+					live++;
+				}
+			}
+		}
+		if(!line->renamed && find_name(line->tac.dest)->last_pos == -1)
+		{
+			find_name(line->tac.dest)->last_pos = i;
+			live++;
+		}
+
+		live += consume_line(line);
+		if(live > NUM_REG)
+		{
+			excess += live - NUM_REG;
+		}
+		live -= name_ends[i];
+	}
+
+	free(name_ends);
+
+	return excess;
+}
+
+// Order the block [start, end) with list scheduling
+void list_schedule(int * order, int start, int end)
+{
+	int num_candidates = 0;
+	int * candidates = malloc(sizeof(int) * (end - start));		// Lines whose predecessors are all scheduled
+	if(candidates == NULL)
+	{
+		printf("Couldn't allocate candidates for scheduling\n");
+		exit(1);
+	}
+
+	int i, j;
+	for(i = start; i < end; i++)
+	{
+		lines[i].uses_left = lines[i].num_uses;
+		lines[i].earliest = 0;
+		if(lines[i].preds_left == 0)
+		{
+			candidates[num_candidates++] = i;
+		}
+	}
+
+	int cycle = 0;
+	int live = 0;
+	for(i = 0; i < end - start; i++)
+	{
+		// Best candidate: frees registers first when at the limit, then can start
+		// right away, then has the longest path left, then comes first
+		int best = 0;
+		for(j = 1; j < num_candidates; j++)
+		{
+			Sched_Line * a = &lines[candidates[j]];
+			Sched_Line * b = &lines[candidates[best]];
+
+			if(live >= NUM_REG && pressure_change(a) != pressure_change(b))
+			{
+				if(pressure_change(a) < pressure_change(b))
+				{
+					best = j;
+				}
+				continue;
+			}
+
+			int a_ready = a->earliest <= cycle;
+			int b_ready = b->earliest <= cycle;
+			if(a_ready != b_ready)
+			{
+				if(a_ready)
+				{
+					best = j;
+				}
+			}
+			else if(a->height != b->height)
+			{
+				if(a->height > b->height)
+				{
+					best = j;
+				}
+			}
+			else if(candidates[j] < candidates[best])
+			{
+				best = j;
+			}
+		}
+
+		int line_num = candidates[best];
+		candidates[best] = candidates[--num_candidates];
+		order[i] = line_num;
+
+		Sched_Line * line = &lines[line_num];
+		if(line->earliest > cycle)
+		{
+			cycle = line->earliest;
+		}
+		live += consume_line(line);
+
+		for(j = 0; j < line->num_succs; j++)
+		{
+			Sched_Line * succ = &lines[line->succs[j]];
+			if(succ->earliest < cycle + line->succ_delays[j])
+			{
+				succ->earliest = cycle + line->succ_delays[j];
+			}
+
+			succ->preds_left--;
+			if(succ->preds_left == 0)
+			{
+				candidates[num_candidates++] = line->succs[j];
+			}
+		}
+
+		cycle++;
+	}
+
+	free(candidates);
+
+	return;
+}
+
+// Give the temp values of the block new names in their scheduled order
+// Each value gets the lowest numbered temp not holding a value that's still needed
+// Temps that keep their names are never handed out
+// Returns 0 if more temps would be needed than the allocator can handle
+int rename_temps(int * order, int start, int end, int * num_temps)
+{
+	int in_use[MAX_SCHED_TEMPS];
+	memset(in_use, 0, sizeof(in_use));
+
+	int i, j;
+	for(i = 0; i < names_size; i++)
+	{
+		if(names[i].name != NULL && names[i].keep && is_temp(names[i].name))
+		{
+			int temp = atoi(names[i].name + 2);
+			if(temp >= MAX_SCHED_TEMPS)
+			{
+				return 0;
+			}
+			in_use[temp] = 1;
+		}
+	}
+
+	for(i = start; i < end; i++)
+	{
+		lines[i].uses_left = lines[i].num_uses;
+	}
+
+	int new_num_temps = *num_temps;
+	for(i = 0; i < end - start; i++)
+	{
+		Sched_Line * line = &lines[order[i]];
+
+		for(j = 0; j < line->tac.num_srcs; j++)
+		{
+			int def = line->src_defs[j];
+			if(def != -1 && lines[def].renamed)
+			{
+				sprintf(line->tac.srcs[j], "_t%d", lines[def].new_temp);
+				lines[def].uses_left--;
+				if(lines[def].uses_left == 0)
+				{
+					in_use[lines[def].new_temp] = 0;
+				}
+			}
+		}
+
+		if(line->renamed)
+		{
+			int temp = 0;
+			while(temp < MAX_SCHED_TEMPS && in_use[temp])
+			{
+				temp++;
+			}
+			if(temp >= MAX_SCHED_TEMPS)
+			{
+				return 0;
+			}
+
+			line->new_temp = temp;
+			in_use[temp] = line->num_uses > 0;
+			sprintf(line->tac.dest, "_t%d", temp);
+			if(temp + 1 > new_num_temps)
+			{
+				new_num_temps = temp + 1;
+			}
+		}
+	}
+
+	*num_temps = new_num_temps;
+
+	return 1;
+}
+
+// Schedule the block [start, end) and write it out
+void schedule_block(FILE * output_file, int start, int end, int * num_temps)
+{
+	int i;
+	int num_block_lines = end - start;
+	if(num_block_lines < 2)
+	{
+		for(i = start; i < end; i++)
+		{
+			fprintf(output_file, "%s", lines[i].tac.text);
+		}
+		return;
+	}
+
+	names_size = 16;
+	while(names_size < num_block_lines * 6)
+	{
+		names_size *= 2;
+	}
+	names = calloc(names_size, sizeof(Name_Entry));
+	int * order = malloc(sizeof(int) * num_block_lines);
+	int * original = malloc(sizeof(int) * num_block_lines);
+	if(names == NULL || order == NULL || original == NULL)
+	{
+		printf("Couldn't allocate block for scheduling\n");
+		exit(1);
+	}
+
+	for(i = 0; i < num_block_lines; i++)
+	{
+		original[i] = start + i;
+	}
+
+	build_dependences(start, end);
+	list_schedule(order, start, end);
+
+	// Pressure guard: don't trade spills for the extra parallelism
+	if(spill_pressure(order, start, end) > spill_pressure(original, start, end)
+	|| !rename_temps(order, start, end, num_temps))
+	{
+		for(i = start; i < end; i++)
+		{
+			fprintf(output_file, "%s", lines[i].tac.text);
+		}
+	}
+	else
+	{
+		for(i = 0; i < num_block_lines; i++)
+		{
+			write_tac_line(&lines[order[i]].tac);
+			fprintf(output_file, "%s", lines[order[i]].tac.text);
+		}
+	}
+
+	for(i = 0; i < names_size; i++)
+	{
+		free(names[i].readers);
+	}
+	for(i = start; i < end; i++)
+	{
+		free(lines[i].succs);
+		free(lines[i].succ_delays);
+	}
+	free(names);
+	free(order);
+	free(original);
+
+	return;
+}
+
+// Schedule every straight-line block of a TAC file
+// Returns the number of temp vars the scheduled TAC uses (at least num_temps)
+int schedule_tac(char * input_tac_file_name, char * output_tac_file_name, int num_temps)
+{
+	read_sched_lines(input_tac_file_name);
+	find_live_temps();
+
+	FILE * output_file = calc_fopen(output_tac_file_name, "w");
+	if(output_file == NULL)
+	{
+		printf("Unable to create for writing %s for scheduling\n", output_tac_file_name);
+		exit(1);
+	}
+
+	int start = 0;
+	int i;
+	for(i = 0; i < num_lines; i++)
+	{
+		if(lines[i].tac.kind != TAC_ASSIGN)
+		{
+			schedule_block(output_file, start, i, &num_temps);
+			fprintf(output_file, "%s", lines[i].tac.text);
+			start = i + 1;
+		}
+	}
+	schedule_block(output_file, start, num_lines, &num_temps);
+
+	fclose(output_file);
+
+	for(i = 0; i < num_lines; i++)
+	{
+		free(lines[i].live_temps);
+	}
+	free(lines);
+	lines = NULL;
+	num_lines = 0;
+
+	return num_temps;
+}
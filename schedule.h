@@ -0,0 +1,6 @@
+#define LATENCY_POW				20		// Estimated cycles for ** (pow call)
+#define LATENCY_DIV				20		// Estimated cycles for /
+#define LATENCY_MUL				3		// Estimated cycles for *
+#define LATENCY_ALU				1		// Estimated cycles for everything else
+
+int schedule_tac(char * input_tac_file_name, char * output_tac_file_name, int num_temps);
@@ -0,0 +1,248 @@
+#include "files.h"
+#include "protocol.h"
+#include "server.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// Persistent compile server
+// Requests come in on stdin (responses go to stdout) or on a local UNIX socket,
+// framed as described in protocol.h. Each socket connection is served by its own
+// forked process, so parallel clients don't wait on each other, and one that
+// stalls is dropped after SERVER_IO_TIMEOUT_SEC.
+// Each request is compiled in a forked child: the child starts from the server's
+// already initialized state, so nothing has to be reset between requests, and an
+// error that exits only ends that request.
+// The child keeps all of the compiler's files in memory and sends them back
+// with everything the compiler printed; the server then reports the latency.
+
+int response_fd;				// Where the child sends its response
+int request_done = 0;			// Set in the child once the compile finished normally
+char * log_data = NULL;			// Everything the compiler printed (child's stdout)
+size_t log_size = 0;
+
+// Send a header line and the contents after it
+void write_section(int fd, char * header, char * data, size_t size)
+{
+	write_all(fd, header, strlen(header));
+	if(size > 0)
+	{
+		write_all(fd, data, size);
+	}
+
+	return;
+}
+
+// Runs when the child exits: sends the output files (if the compile finished) and the log
+void send_response()
+{
+	char header[MAX_FRAME_LINE_LEN];
+
+	fflush(stdout);
+
+	if(request_done)
+	{
+		char * name;
+		char * data;
+		size_t size;
+		int i;
+		for(i = 0; get_memory_file(i, &name, &data, &size); i++)
+		{
+			if(name != NULL && strcmp(name, SERVER_INPUT_NAME) != 0)
+			{
+				sprintf(header, "FILE %s %zu\n", name, size);
+				write_section(response_fd, header, data, size);
+			}
+		}
+	}
+
+	sprintf(header, "LOG %zu\n", log_size);
+	write_section(response_fd, header, log_data, log_size);
+
+	return;
+}
+
+// Compile one request; the header line has already been read
+// Returns 0 if the request isn't valid (the connection is dropped)
+int serve_request(int in_fd, int out_fd, char * header)
+{
+	char * args[MAX_REQUEST_OPTIONS + 2];
+	int num_args = 0;
+	args[num_args++] = "calc";
+
+	char * token = strtok(header, " ");
+	char * length = strtok(NULL, " ");
+	if(token == NULL || strcmp(token, "COMPILE") != 0 || length == NULL)
+	{
+		return 0;
+	}
+
+	while((token = strtok(NULL, " ")) != NULL)
+	{
+		if(num_args > MAX_REQUEST_OPTIONS)
+		{
+			return 0;
+		}
+		args[num_args++] = token;
+	}
+	args[num_args++] = SERVER_INPUT_NAME;
+
+	size_t program_size = strtoul(length, NULL, 10);
+	char * program = malloc(program_size + 1);
+	if(program == NULL || !read_all(in_fd, program, program_size))
+	{
+		free(program);
+		return 0;
+	}
+
+	struct timespec start, stop;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	fflush(stdout);		// Child mustn't inherit anything still buffered
+	pid_t pid = fork();
+	if(pid < 0)
+	{
+		printf("Unable to fork for compile request\n");
+		exit(1);
+	}
+
+	if(pid == 0)
+	{
+		use_memory_files();
+
+		FILE * input_file = calc_fopen(SERVER_INPUT_NAME, "w");
+		fwrite(program, 1, program_size, input_file);
+		fclose(input_file);
+
+		stdout = open_memstream(&log_data, &log_size);
+		response_fd = out_fd;
+		atexit(send_response);
+
+		int status = compile(num_args, args);
+		request_done = 1;
+		exit(status);
+	}
+
+	int status;
+	waitpid(pid, &status, 0);
+	free(program);
+
+	clock_gettime(CLOCK_MONOTONIC, &stop);
+	long latency = (stop.tv_sec - start.tv_sec) * 1000000 + (stop.tv_nsec - start.tv_nsec) / 1000;
+
+	char end[MAX_FRAME_LINE_LEN];
+	sprintf(end, "END %d %ld\n", WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status), latency);
+
+	return write_all(out_fd, end, strlen(end));
+}
+
+// Serve requests until the other end closes
+void serve_connection(int in_fd, int out_fd)
+{
+	char header[MAX_FRAME_LINE_LEN];
+	while(read_line(in_fd, header, MAX_FRAME_LINE_LEN) >= 0)
+	{
+		if(!serve_request(in_fd, out_fd, header))
+		{
+			return;
+		}
+	}
+
+	return;
+}
+
+// SIGCHLD handler of the socket server: reap every connection process that's done,
+// so an idle server doesn't keep them around as zombies
+void reap_connections(int signal_number)
+{
+	int saved_errno = errno;
+
+	while(waitpid(-1, NULL, WNOHANG) > 0)
+	{
+	}
+
+	errno = saved_errno;
+	return;
+}
+
+// Serve requests from stdin (socket_path NULL) or from clients connecting to a UNIX socket
+int run_server(char * socket_path)
+{
+	signal(SIGPIPE, SIG_IGN);	// A client going away shouldn't end the server
+
+	if(socket_path == NULL)
+	{
+		serve_connection(0, 1);
+		return 0;
+	}
+
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if(strlen(socket_path) >= sizeof(address.sun_path))
+	{
+		printf("Socket path too long\n");
+		exit(1);
+	}
+	strcpy(address.sun_path, socket_path);
+
+	int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	unlink(socket_path);
+	if(server_fd < 0 || bind(server_fd, (struct sockaddr *) &address, sizeof(address)) != 0 || listen(server_fd, 16) != 0)
+	{
+		printf("Unable to listen on %s\n", socket_path);
+		exit(1);
+	}
+
+	printf("Compile server listening on %s\n", socket_path);
+	fflush(stdout);
+
+	struct sigaction reaper;
+	memset(&reaper, 0, sizeof(reaper));
+	reaper.sa_handler = reap_connections;
+	sigemptyset(&reaper.sa_mask);
+	reaper.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+	sigaction(SIGCHLD, &reaper, NULL);
+
+	struct timeval timeout;
+	timeout.tv_sec = SERVER_IO_TIMEOUT_SEC;
+	timeout.tv_usec = 0;
+
+	while(1)
+	{
+		int client_fd = accept(server_fd, NULL, NULL);
+		if(client_fd < 0)
+		{
+			continue;
+		}
+
+		setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		setsockopt(client_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+		pid_t pid = fork();
+		if(pid == 0)
+		{
+			close(server_fd);
+			signal(SIGCHLD, SIG_DFL);	// serve_request waits on its own compile children
+			serve_connection(client_fd, client_fd);
+			exit(0);
+		}
+		else if(pid < 0)
+		{
+			printf("Unable to fork for client connection\n");
+			fflush(stdout);
+		}
+
+		close(client_fd);
+	}
+
+	return 0;
+}
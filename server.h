@@ -0,0 +1,2 @@
+int run_server(char * socket_path);
+int compile(int argc, char * argv[]);		// Defined in calc.y
@@ -0,0 +1,89 @@
+#include "tac.h"
+#include <stdio.h>
+#include <string.h>
+
+// TAC lines as the passes working on them (peephole.c, schedule.c) see them
+// Frontend and register TAC share one format, so they share one parser
+
+// Split a TAC line's text into its parts
+void parse_tac_line(Tac_Line * line)
+{
+	char temp[TAC_LINE_LEN];
+	strcpy(temp, line->text);
+
+	line->dest[0] = '\0';
+	line->op[0] = '\0';
+	line->num_srcs = 0;
+
+	if(strstr(temp, "if(") != NULL)
+	{
+		line->kind = TAC_IF;
+		strtok(temp, "()");					// Skip over "if"
+		strcpy(line->srcs[0], strtok(NULL, "()"));
+		line->num_srcs = 1;
+	}
+	else if(strstr(temp, "} else {") != NULL)
+	{
+		line->kind = TAC_ELSE;
+	}
+	else if(strstr(temp, "}") != NULL)
+	{
+		line->kind = TAC_END_IF;
+	}
+	else	// dest = a; dest = !a; dest = a op b;
+	{
+		line->kind = TAC_ASSIGN;
+		strcpy(line->dest, strtok(temp, " =;\n"));
+
+		char * one = strtok(NULL, " =;\n");
+		char * op = strtok(NULL, " ;\n");
+		char * three = strtok(NULL, " ;\n");
+
+		if(one[0] == '!')
+		{
+			strcpy(line->op, "!");
+			strcpy(line->srcs[0], one + 1);
+			line->num_srcs = 1;
+		}
+		else if(op == NULL)
+		{
+			strcpy(line->srcs[0], one);
+			line->num_srcs = 1;
+		}
+		else
+		{
+			strcpy(line->op, op);
+			strcpy(line->srcs[0], one);
+			strcpy(line->srcs[1], three);
+			line->num_srcs = 2;
+		}
+	}
+
+	return;
+}
+
+// Rebuild a line's text after its operands were changed
+void write_tac_line(Tac_Line * line)
+{
+	if(line->kind == TAC_IF)
+	{
+		sprintf(line->text, "if(%s) {\n", line->srcs[0]);
+	}
+	else if(line->kind == TAC_ASSIGN)
+	{
+		if(line->op[0] == '\0')
+		{
+			sprintf(line->text, "%s = %s;\n", line->dest, line->srcs[0]);
+		}
+		else if(line->num_srcs == 1)
+		{
+			sprintf(line->text, "%s = !%s;\n", line->dest, line->srcs[0]);
+		}
+		else
+		{
+			sprintf(line->text, "%s = %s %s %s;\n", line->dest, line->srcs[0], line->op, line->srcs[1]);
+		}
+	}
+
+	return;
+}
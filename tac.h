@@ -0,0 +1,23 @@
+#include "reg_alloc.h"
+
+#define TAC_LINE_LEN			(MAX_USR_VAR_NAME_LEN * 4)	// Max length of a TAC line's text
+
+#define TAC_ASSIGN				0		// x = a; x = !a; x = a op b; (op includes ? selects)
+#define TAC_IF					1		// if(a) {
+#define TAC_ELSE				2		// } else {
+#define TAC_END_IF				3		// }
+
+// A TAC line (frontend or register TAC) split into its parts
+typedef struct tac_line
+{
+	char text[TAC_LINE_LEN];				// Line as it is written out
+
+	int kind;								// TAC_ASSIGN, TAC_IF, TAC_ELSE or TAC_END_IF
+	char dest[MAX_USR_VAR_NAME_LEN + 1];	// Variable or register being assigned
+	char op[3];								// "" for copies, "!" for unary, otherwise binary operator
+	int num_srcs;							// Operands read by the line (if condition is an operand)
+	char srcs[2][MAX_USR_VAR_NAME_LEN + 1];
+} Tac_Line;
+
+void parse_tac_line(Tac_Line * line);
+void write_tac_line(Tac_Line * line);